@@ -0,0 +1,68 @@
+#include "benchmark.h"
+#include "linediff.h"
+#include "textencoding.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QVector>
+#include <algorithm>
+
+int Benchmark::check(const char *name, double elapsed, qint64 budget) {
+  const bool within = elapsed <= budget;
+  qInfo().noquote() << QString("%1: %2 ms of a budget of %3 ms, %4")
+                           .arg(name)
+                           .arg(elapsed, 0, 'f', 2)
+                           .arg(budget)
+                           .arg(within ? "passed" : "failed");
+  return within ? 0 : 1;
+}
+
+int Benchmark::decode(const QString &fileName, qint64 budget) {
+  QFile file(fileName);
+  if (!file.open(QFile::ReadOnly))
+    return 1;
+  const QByteArray contents = file.readAll();
+  const double mebibytes = contents.size() / (1024.0 * 1024.0);
+  if (budget < 0)
+    budget = std::max<qint64>(qint64(mebibytes * 2), 1);
+
+  const int rounds = 10;
+  TextEncoding encoding;
+  QElapsedTimer timer;
+  timer.start();
+  for (int i = 0; i < rounds; ++i)
+    TextEncoding::decode(contents, &encoding);
+  const double elapsed = std::max<qint64>(timer.nsecsElapsed(), 1) / 1e6;
+  qInfo() << "Decode:" << encoding.name()
+          << mebibytes * rounds / (elapsed / 1000) << "MiB/s";
+  return check("Decode", elapsed / rounds, budget);
+}
+
+int Benchmark::diff(const QString &oldFileName, const QString &newFileName,
+                    qint64 budget) {
+  QStringList lines[2];
+  const QString fileNames[2] = {oldFileName, newFileName};
+  for (int i = 0; i < 2; ++i) {
+    QFile file(fileNames[i]);
+    if (!file.open(QFile::ReadOnly))
+      return 1;
+    TextEncoding encoding;
+    lines[i] = TextEncoding::decode(file.readAll(), &encoding).split('\n');
+  }
+
+  QElapsedTimer timer;
+  timer.start();
+  QVector<quint64> hashes[2];
+  for (int i = 0; i < 2; ++i)
+    for (const auto &line : lines[i])
+      hashes[i].push_back(LineDiff::hash(line));
+  const double hashing = timer.nsecsElapsed() / 1e6;
+  const auto hunks =
+      LineDiff::compute(hashes[0].constData(), hashes[0].size(),
+                        hashes[1].constData(), hashes[1].size());
+  const double elapsed = timer.nsecsElapsed() / 1e6;
+  qInfo() << "Diff:" << hashes[0].size() << "against" << hashes[1].size()
+          << "lines," << hunks.size() << "hunks, hashed in" << hashing
+          << "ms, diffed in" << elapsed - hashing << "ms";
+  return check("Diff", elapsed, budget < 0 ? 100 : budget);
+}
@@ -0,0 +1,23 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QString>
+
+// the benchmarks run from the command line: each prints its timings and
+// returns the exit code, 1 when it could not run or took longer than its
+// budget in ms, which defaults to a budget of its own for a negative one
+class Benchmark {
+public:
+  // decoding file as it is on load, the budget is of one decode and defaults
+  // to 2 ms per MiB
+  static int decode(const QString &fileName, qint64 budget = -1);
+  // hashing the lines of two files and diffing them, as the diff view does
+  // against its base; the budget defaults to 100 ms
+  static int diff(const QString &oldFileName, const QString &newFileName,
+                  qint64 budget = -1);
+
+  // whether the elapsed ms are within budget, printed either way
+  static int check(const char *name, double elapsed, qint64 budget);
+};
+
+#endif // BENCHMARK_H
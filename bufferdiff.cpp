@@ -0,0 +1,171 @@
+#include "bufferdiff.h"
+#include "cppsyntaxhightlighter.h"
+#include "documentedits.h"
+#include <QElapsedTimer>
+#include <QTextBlock>
+#include <QTextDocument>
+#include <algorithm>
+
+namespace {
+// a line not hashed yet, a real hash being 0 only costs a needless rehash
+const quint64 staleHash = 0;
+// edits of long lines are hashed once typing pauses, not per keystroke
+const int longLineDelay = 300; // ms
+} // namespace
+
+BufferDiff::BufferDiff(QTextDocument *document, QObject *parent)
+    : QObject(parent), m_document{document} {
+  m_update.setSingleShot(true);
+  connect(&m_update, &QTimer::timeout, this, &BufferDiff::update);
+  connect(DocumentEdits::of(document), &DocumentEdits::edited, this,
+          &BufferDiff::documentChanged);
+}
+
+void BufferDiff::setBase(const QString &text) {
+  m_hasBase = true;
+  m_baseLines = text.split('\n');
+  m_baseHashes.resize(m_baseLines.size());
+  std::transform(m_baseLines.cbegin(), m_baseLines.cend(),
+                 m_baseHashes.begin(), &LineDiff::hash);
+  m_hashes.clear();
+  m_hashes.reserve(m_document->blockCount());
+  for (auto block = m_document->begin(); block.isValid(); block = block.next())
+    m_hashes.push_back(LineDiff::hash(block.text()));
+  m_hunks.clear();
+  m_dirtyFirst = 0;
+  m_dirtyLast = m_hashes.size();
+  update();
+}
+
+void BufferDiff::clearBase() {
+  m_hasBase = false;
+  m_baseLines.clear();
+  m_baseHashes.clear();
+  m_hashes.clear();
+  m_hunks.clear();
+  m_dirtyFirst = m_dirtyLast = -1;
+  m_update.stop();
+  emit changed();
+}
+
+BufferDiff::Mark BufferDiff::mark(int line) const {
+  // the last hunk starting at or before line
+  auto it = std::upper_bound(m_hunks.cbegin(), m_hunks.cend(), line,
+                             [](int line, const LineDiff::Hunk &hunk) {
+                               return line < hunk.newStart;
+                             });
+  if (it == m_hunks.cbegin())
+    return Unchanged;
+  const auto &hunk = *--it;
+  if (line < hunk.newStart + hunk.newCount)
+    return hunk.oldCount ? Modified : Added;
+  return !hunk.newCount && hunk.newStart == line ? RemovedAbove : Unchanged;
+}
+
+void BufferDiff::documentChanged(int position, int, int charsAdded) {
+  if (!m_hasBase)
+    return;
+  // blocks [first, lastOld] were replaced by [first, lastNew]
+  const int first = m_document->findBlock(position).blockNumber();
+  QTextBlock last = m_document->findBlock(position + charsAdded);
+  if (!last.isValid())
+    last = m_document->lastBlock();
+  const int lastNew = last.blockNumber(),
+            delta = m_document->blockCount() - m_hashes.size(),
+            lastOld = lastNew - delta;
+  QVector<quint64> hashes;
+  hashes.reserve(lastNew - first + 1);
+  bool longLine = false;
+  for (auto block = m_document->findBlockByNumber(first);
+       block.isValid() && block.blockNumber() <= lastNew;
+       block = block.next()) {
+    const bool isLong =
+        block.length() > CppSyntaxHightlighter::longLineThreshold;
+    longLine = longLine || isLong;
+    hashes.push_back(isLong ? staleHash : LineDiff::hash(block.text()));
+  }
+  m_hashes.erase(m_hashes.begin() + first, m_hashes.begin() + lastOld + 1);
+  m_hashes.insert(first, hashes.size(), 0);
+  std::copy(hashes.cbegin(), hashes.cend(), m_hashes.begin() + first);
+
+  // in the numbering before the edit, the dirty region takes in the edited
+  // lines and every hunk touching it; the hunks after it move along
+  int dirtyFirst = first, dirtyLast = lastOld + 1;
+  if (m_dirtyFirst >= 0) {
+    dirtyFirst = std::min(dirtyFirst, m_dirtyFirst);
+    dirtyLast = std::max(dirtyLast, m_dirtyLast);
+  }
+  for (bool grown = true; grown;) {
+    grown = false;
+    for (int i = 0; i < m_hunks.size();) {
+      const auto &hunk = m_hunks[i];
+      if (hunk.newStart > dirtyLast ||
+          hunk.newStart + hunk.newCount < dirtyFirst) {
+        ++i;
+        continue;
+      }
+      grown = grown || hunk.newStart < dirtyFirst ||
+              hunk.newStart + hunk.newCount > dirtyLast;
+      dirtyFirst = std::min(dirtyFirst, hunk.newStart);
+      dirtyLast = std::max(dirtyLast, hunk.newStart + hunk.newCount);
+      m_hunks.remove(i);
+    }
+  }
+  for (auto &hunk : m_hunks)
+    if (hunk.newStart > dirtyLast)
+      hunk.newStart += delta;
+  m_dirtyFirst = dirtyFirst;
+  m_dirtyLast = dirtyLast + delta;
+  // 0 for once a burst of edits is done
+  m_update.start(longLine ? longLineDelay : 0);
+}
+
+void BufferDiff::update() {
+  if (!m_hasBase || m_dirtyFirst < 0)
+    return;
+  QElapsedTimer timer;
+  timer.start();
+  // the long lines edited since the last update, stale lines are only ever
+  // in the dirty region
+  QTextBlock block = m_document->findBlockByNumber(m_dirtyFirst);
+  for (int i = m_dirtyFirst; i < m_dirtyLast && block.isValid();
+       ++i, block = block.next())
+    if (m_hashes[i] == staleHash)
+      m_hashes[i] = LineDiff::hash(block.text());
+
+  // outside the dirty region lines are unchanged, so the hunks before and
+  // after it tell where its ends are in the base
+  const auto after =
+      std::find_if(m_hunks.begin(), m_hunks.end(),
+                   [this](const LineDiff::Hunk &h) {
+                     return h.newStart >= m_dirtyFirst;
+                   });
+  int shiftBefore = 0, shiftAfter = 0;
+  for (auto it = m_hunks.cbegin(); it != after; ++it)
+    shiftBefore += it->newCount - it->oldCount;
+  for (auto it = after; it != m_hunks.end(); ++it)
+    shiftAfter += it->newCount - it->oldCount;
+  const int baseFirst = m_dirtyFirst - shiftBefore,
+            baseLast = m_baseHashes.size() -
+                       (m_hashes.size() - m_dirtyLast - shiftAfter);
+
+  QVector<LineDiff::Hunk> region;
+  if (baseFirst >= 0 && baseFirst <= baseLast &&
+      baseLast <= m_baseHashes.size()) {
+    region = LineDiff::compute(m_baseHashes.constData() + baseFirst,
+                               baseLast - baseFirst,
+                               m_hashes.constData() + m_dirtyFirst,
+                               m_dirtyLast - m_dirtyFirst);
+    for (auto &hunk : region)
+      hunk.oldStart += baseFirst, hunk.newStart += m_dirtyFirst;
+    const int index = int(after - m_hunks.begin());
+    for (int i = 0; i < region.size(); ++i)
+      m_hunks.insert(index + i, region[i]);
+  } else { // out of step, which should not happen, start over
+    m_hunks = LineDiff::compute(m_baseHashes.constData(), m_baseHashes.size(),
+                                m_hashes.constData(), m_hashes.size());
+  }
+  m_dirtyFirst = m_dirtyLast = -1;
+  m_lastDiffNsecs = timer.nsecsElapsed();
+  emit changed();
+}
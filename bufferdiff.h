@@ -0,0 +1,54 @@
+#ifndef BUFFERDIFF_H
+#define BUFFERDIFF_H
+
+#include "linediff.h"
+#include <QObject>
+#include <QStringList>
+#include <QTimer>
+#include <QVector>
+
+class QTextDocument;
+
+// the lines of a document that differ from a base version of it, kept up to
+// date while typing: the document's lines are hashed as they change and an
+// edit only has the region between the unchanged lines around it diffed again
+class BufferDiff : public QObject {
+  Q_OBJECT
+public:
+  enum Mark { Unchanged, Added, Modified, RemovedAbove };
+
+  explicit BufferDiff(QTextDocument *document, QObject *parent = nullptr);
+
+  // the version to compare with, the whole document is diffed against it
+  void setBase(const QString &text);
+  void clearBase();
+  bool hasBase() const { return m_hasBase; }
+  const QStringList &baseLines() const { return m_baseLines; }
+
+  // sorted by position, newStart counts blocks of the document
+  const QVector<LineDiff::Hunk> &hunks() const { return m_hunks; }
+  // how the block numbered line differs from the base
+  Mark mark(int line) const;
+  // time the last diff took, of the whole document or of an edited region
+  qint64 lastDiffNsecs() const { return m_lastDiffNsecs; }
+
+signals:
+  void changed();
+
+private:
+  QTextDocument *m_document;
+  bool m_hasBase = false;
+  QStringList m_baseLines;
+  QVector<quint64> m_baseHashes, m_hashes;
+  QVector<LineDiff::Hunk> m_hunks;
+  // lines [first, last) of the document that are diffed again on update,
+  // the hunks that were in them are dropped already
+  int m_dirtyFirst = -1, m_dirtyLast = -1;
+  QTimer m_update;
+  qint64 m_lastDiffNsecs = 0;
+
+  void documentChanged(int position, int charsRemoved, int charsAdded);
+  void update();
+};
+
+#endif // BUFFERDIFF_H
@@ -0,0 +1,84 @@
+#include "compiletimegraph.h"
+#include <QDateTime>
+#include <QHelpEvent>
+#include <QPainter>
+#include <QToolTip>
+
+namespace {
+constexpr int barWidth = 6, barGap = 2;
+
+// parse, templates, optimization, codegen
+const QColor phaseColors[] = {
+    QColor(0x4e, 0x79, 0xa7), QColor(0xf2, 0x8e, 0x2b), QColor(0x59, 0xa1, 0x4f),
+    QColor(0xe1, 0x57, 0x59)};
+} // namespace
+
+CompileTimeGraph::CompileTimeGraph(QWidget *parent) : QWidget(parent) {
+  setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
+  setToolTip(tr("Parse, templates, optimization and codegen of recent builds"));
+}
+
+void CompileTimeGraph::setBuilds(const QVector<CompileTimes> &builds) {
+  m_builds = builds;
+  update();
+}
+
+QSize CompileTimeGraph::sizeHint() const {
+  return {CompileTimeHistory::maxBuilds * (barWidth + barGap),
+          fontMetrics().height() * 3};
+}
+
+int CompileTimeGraph::buildAt(int x) const {
+  // the newest build is drawn at the right edge
+  const int fromRight = (width() - 1 - x) / (barWidth + barGap);
+  const int i = m_builds.size() - 1 - fromRight;
+  return i >= 0 && i < m_builds.size() ? i : -1;
+}
+
+void CompileTimeGraph::paintEvent(QPaintEvent *) {
+  QPainter painter(this);
+  painter.fillRect(rect(), palette().base());
+  double longest = 0;
+  for (const auto &build : m_builds)
+    longest = std::max(longest, build.total);
+  if (longest <= 0)
+    return;
+
+  const double scale = (height() - 2) / longest;
+  int x = width() - barWidth;
+  for (int i = m_builds.size() - 1; i >= 0 && x >= 0; --i) {
+    const auto &build = m_builds[i];
+    // what the phases do not account for shows above them
+    const double total = build.total * scale;
+    painter.fillRect(QRectF(x, height() - total, barWidth, total),
+                     palette().mid());
+    const double phases[] = {build.parse, build.templates, build.optimization,
+                             build.codegen};
+    double bottom = height();
+    for (int p = 0; p < 4; ++p) {
+      const double h = phases[p] * scale;
+      painter.fillRect(QRectF(x, bottom - h, barWidth, h), phaseColors[p]);
+      bottom -= h;
+    }
+    x -= barWidth + barGap;
+  }
+}
+
+bool CompileTimeGraph::event(QEvent *event) {
+  if (event->type() != QEvent::ToolTip)
+    return QWidget::event(event);
+  auto help = static_cast<QHelpEvent *>(event);
+  const int i = buildAt(help->pos().x());
+  if (i < 0) {
+    QToolTip::showText(help->globalPos(), toolTip(), this);
+  } else {
+    const auto &build = m_builds[i];
+    QToolTip::showText(
+        help->globalPos(),
+        QDateTime::fromMSecsSinceEpoch(build.timestamp)
+                .toString(Qt::SystemLocaleShortDate) +
+            "\n" + build.summary(),
+        this);
+  }
+  return true;
+}
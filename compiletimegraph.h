@@ -0,0 +1,28 @@
+#ifndef COMPILETIMEGRAPH_H
+#define COMPILETIMEGRAPH_H
+
+#include "compiletimes.h"
+#include <QWidget>
+
+// the recent builds of a file as stacked bars, one colour per phase, so that
+// a slowdown and where it comes from show at a glance
+class CompileTimeGraph : public QWidget {
+  Q_OBJECT
+public:
+  explicit CompileTimeGraph(QWidget *parent = nullptr);
+
+  void setBuilds(const QVector<CompileTimes> &builds);
+
+  QSize sizeHint() const override;
+
+protected:
+  void paintEvent(QPaintEvent *event) override;
+  bool event(QEvent *event) override;
+
+private:
+  QVector<CompileTimes> m_builds;
+
+  int buildAt(int x) const;
+};
+
+#endif // COMPILETIMEGRAPH_H
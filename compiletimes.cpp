@@ -0,0 +1,178 @@
+#include "compiletimes.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <algorithm>
+
+namespace {
+// gcc's timevars that belong to the back end, the rest of "phase opt and
+// generate" is counted as optimization
+const char *const codegenTimevars[] = {
+    "expand",
+    "integrated RA",
+    "LRA non-specific",
+    "LRA create live ranges",
+    "LRA hard reg assignment",
+    "reload",
+    "scheduling",
+    "scheduling 2",
+    "thread pro- & epilogue",
+    "peephole 2",
+    "machine dep reorg",
+    "shorten branches",
+    "final",
+    "symout"};
+
+QString historyKey(const QString &fileName) {
+  return fileName.isEmpty() ? QString("<untitled>")
+                            : QFileInfo(fileName).absoluteFilePath();
+}
+} // namespace
+
+bool CompileTimes::fromGccReport(const QString &output, CompileTimes *times,
+                                 int *start, int *end) {
+  const int table = output.indexOf("Time variable");
+  if (table < 0)
+    return false;
+  // name : usr (pct) sys (pct) wall (pct) ggc (pct), older gccs also label
+  // each column
+  static const QRegularExpression row(R"(^\s*([^:\n]+?)\s*:([^\n]*))",
+                                      QRegularExpression::MultilineOption);
+  static const QRegularExpression percent(R"(\(\s*\d+%\)\s*(usr|sys|wall)?)");
+  static const QRegularExpression separator(R"([^\d.]+)");
+
+  CompileTimes result;
+  double optAndGenerate = 0;
+  int last = table;
+  auto it = row.globalMatch(output, table);
+  while (it.hasNext()) {
+    const auto match = it.next();
+    const QString name = match.captured(1);
+    if (name.startsWith('|'))
+      continue; // nested in another timevar
+    QString cells = match.captured(2);
+    cells.remove(percent);
+    const QStringList numbers = cells.split(separator, QString::SkipEmptyParts);
+    const double wall = numbers.value(2).toDouble() * 1000;
+    last = match.capturedEnd();
+
+    if (name == "phase parsing" || name == "phase lang. deferred")
+      result.parse += wall;
+    else if (name == "template instantiation")
+      result.templates += wall;
+    else if (name == "phase opt and generate")
+      optAndGenerate += wall;
+    else if (std::find(std::begin(codegenTimevars), std::end(codegenTimevars),
+                       name) != std::end(codegenTimevars))
+      result.codegen += wall;
+    else if (name == "TOTAL") {
+      result.total = wall;
+      break;
+    }
+  }
+  if (result.total <= 0)
+    return false;
+  // instantiation is part of parsing in gcc's phases
+  result.parse = std::max(0.0, result.parse - result.templates);
+  result.optimization = std::max(0.0, optAndGenerate - result.codegen);
+  *times = result;
+  if (start)
+    *start = output.lastIndexOf('\n', table) + 1;
+  if (end)
+    *end = last;
+  return true;
+}
+
+bool CompileTimes::fromClangTrace(const QByteArray &trace,
+                                  CompileTimes *times) {
+  const QJsonArray events =
+      QJsonDocument::fromJson(trace).object().value("traceEvents").toArray();
+  CompileTimes result;
+  for (const auto &value : events) {
+    const QJsonObject event = value.toObject();
+    const QString name = event.value("name").toString();
+    const double ms = event.value("dur").toDouble() / 1000; // from us
+    if (name == "Total Frontend")
+      result.parse += ms;
+    else if (name == "Total InstantiateFunction" ||
+             name == "Total InstantiateClass")
+      result.templates += ms;
+    else if (name == "Total Optimizer" || name == "Total OptModule")
+      result.optimization += ms;
+    else if (name == "Total CodeGenPasses")
+      result.codegen += ms;
+    else if (name == "Total ExecuteCompiler")
+      result.total = ms;
+  }
+  if (result.total <= 0)
+    return false;
+  result.parse = std::max(0.0, result.parse - result.templates);
+  *times = result;
+  return true;
+}
+
+QString CompileTimes::summary() const {
+  return QString("parse %1 ms, templates %2 ms, optimization %3 ms, codegen "
+                 "%4 ms, total %5 ms")
+      .arg(parse, 0, 'f', 0)
+      .arg(templates, 0, 'f', 0)
+      .arg(optimization, 0, 'f', 0)
+      .arg(codegen, 0, 'f', 0)
+      .arg(total, 0, 'f', 0);
+}
+
+CompileTimeHistory::CompileTimeHistory(const QString &path) : m_path{path} {}
+
+QString CompileTimeHistory::defaultPath() {
+  return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) +
+         "/compile-times.json";
+}
+
+QVector<CompileTimes>
+CompileTimeHistory::builds(const QString &fileName) const {
+  QFile file(m_path);
+  if (!file.open(QFile::ReadOnly))
+    return {};
+  const QJsonArray entries = QJsonDocument::fromJson(file.readAll())
+                                 .object()
+                                 .value(historyKey(fileName))
+                                 .toArray();
+  QVector<CompileTimes> result;
+  for (const auto &value : entries) {
+    const QJsonArray e = value.toArray();
+    result.push_back({qint64(e[0].toDouble()), e[1].toDouble(),
+                      e[2].toDouble(), e[3].toDouble(), e[4].toDouble(),
+                      e[5].toDouble()});
+  }
+  return result;
+}
+
+void CompileTimeHistory::add(const QString &fileName,
+                             const CompileTimes &times) {
+  QJsonObject history;
+  QFile file(m_path);
+  if (file.open(QFile::ReadOnly))
+    history = QJsonDocument::fromJson(file.readAll()).object();
+  file.close();
+
+  QJsonArray entries = history.value(historyKey(fileName)).toArray();
+  entries.append(QJsonArray{double(times.timestamp), times.parse,
+                            times.templates, times.optimization,
+                            times.codegen, times.total});
+  while (entries.size() > maxBuilds)
+    entries.removeFirst();
+  history.insert(historyKey(fileName), entries);
+
+  QDir().mkpath(QFileInfo(m_path).absolutePath());
+  QSaveFile out(m_path);
+  if (out.open(QFile::WriteOnly)) {
+    out.write(QJsonDocument(history).toJson(QJsonDocument::Compact));
+    out.commit();
+  }
+}
@@ -0,0 +1,40 @@
+#ifndef COMPILETIMES_H
+#define COMPILETIMES_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+// where the compiler spent a build, in milliseconds of wall time
+struct CompileTimes {
+  qint64 timestamp = 0; // ms since epoch
+  double parse = 0, templates = 0, optimization = 0, codegen = 0, total = 0;
+
+  // reads the -ftime-report table gcc writes to stderr; start and end are
+  // set to the range of output the table takes
+  static bool fromGccReport(const QString &output, CompileTimes *times,
+                            int *start = nullptr, int *end = nullptr);
+  // reads the json -ftime-trace makes clang write
+  static bool fromClangTrace(const QByteArray &trace, CompileTimes *times);
+
+  QString summary() const;
+};
+
+// the timings of the recent builds of each file, kept across sessions
+class CompileTimeHistory {
+public:
+  explicit CompileTimeHistory(const QString &path = defaultPath());
+
+  static QString defaultPath();
+
+  QVector<CompileTimes> builds(const QString &fileName) const;
+  // records a build of fileName and saves the history
+  void add(const QString &fileName, const CompileTimes &times);
+
+  static constexpr int maxBuilds = 50; // per file
+
+private:
+  QString m_path;
+};
+
+#endif // COMPILETIMES_H
@@ -0,0 +1,177 @@
+#include "completionengine.h"
+#include "cppsyntaxhightlighter.h"
+#include "symbolindex.h"
+#include <QTextBlock>
+#include <QtConcurrent>
+#include <algorithm>
+#include <vector>
+
+namespace {
+// cheap ascii only pre-check of matchScore on a raw symbol name
+bool isSubsequence(const QByteArray &foldedPattern, const char *name,
+                   int length) {
+  int pi = 0;
+  for (int i = 0; i < length && pi < foldedPattern.size(); ++i)
+    if ((name[i] | 0x20) == foldedPattern[pi] ||
+        (name[i] == '_' && foldedPattern[pi] == '_'))
+      ++pi;
+  return pi == foldedPattern.size();
+}
+} // namespace
+
+CompletionEngine::CompletionEngine(CppSyntaxHightlighter *source,
+                                   QObject *parent)
+    : QObject(parent), m_source{source},
+      m_generation{std::make_shared<std::atomic<quint64>>(0)} {
+  connect(&m_watcher, &QFutureWatcher<QStringList>::finished, this,
+          &CompletionEngine::publishResults);
+}
+
+CompletionEngine::~CompletionEngine() {
+  cancel();
+  m_watcher.waitForFinished();
+}
+
+int CompletionEngine::matchScore(const QString &pattern, const QString &word) {
+  if (pattern.isEmpty() || word.size() < pattern.size())
+    return -1;
+
+  int score = 0, pi = 0, run = 0, firstMatch = -1, lastMatch = -2;
+  for (int wi = 0; wi < word.size() && pi < pattern.size(); ++wi) {
+    const QChar wc = word[wi], pc = pattern[pi];
+    if (wc.toCaseFolded() != pc.toCaseFolded())
+      continue;
+
+    int bonus = 1;
+    if (wi == 0)
+      bonus += 8;
+    else if (word[wi - 1] == '_' ||
+             (word[wi - 1].isLower() && wc.isUpper())) // word boundary
+      bonus += 6;
+    run = lastMatch == wi - 1 ? run + 1 : 0;
+    bonus += 4 * run;
+    if (wc == pc)
+      bonus += 1;
+
+    if (firstMatch < 0)
+      firstMatch = wi;
+    lastMatch = wi;
+    score += bonus;
+    ++pi;
+  }
+  if (pi != pattern.size())
+    return -1;
+
+  // prefer matches that start early and words that are not much longer
+  return std::max(1, score - firstMatch - (word.size() - pattern.size()) / 4);
+}
+
+void CompletionEngine::cancel() { ++*m_generation; }
+
+void CompletionEngine::complete(const QString &prefix,
+                                const QTextBlock &cursorBlock) {
+  const quint64 generation = ++*m_generation;
+  m_pendingGeneration = generation;
+  m_pendingPrefix = prefix;
+
+  // both hashes are implicitly shared, so handing them to the worker is cheap
+  const QHash<QString, int> words = m_source->words();
+  const QHash<QString, int> nearby =
+      m_source->wordsNear(cursorBlock, m_nearbyRadius);
+  const int maxResults = m_maxResults, radius = m_nearbyRadius;
+  auto currentGeneration = m_generation;
+  auto symbols = m_symbols;
+
+  m_watcher.setFuture(QtConcurrent::run([=]() -> QStringList {
+    struct Ranked {
+      int score;
+      QString word;
+    };
+    std::vector<Ranked> ranked;
+    int visited = 0;
+    for (auto it = words.cbegin(); it != words.cend(); ++it) {
+      if ((++visited & 1023) == 0 && *currentGeneration != generation)
+        return {}; // superseded by a newer request
+      if (it.key() == prefix)
+        continue;
+      int score = matchScore(prefix, it.key());
+      if (score < 0)
+        continue;
+
+      score *= 16;
+      int frequency = it.value();
+      while (frequency >>= 1) // log2 of the frequency
+        score += 4;
+      auto near = nearby.constFind(it.key());
+      if (near != nearby.cend())
+        score += 2 * (radius - *near) + 8;
+      ranked.push_back({score, it.key()});
+    }
+
+    if (symbols) {
+      const QByteArray foldedPattern = prefix.toLower().toUtf8();
+      QString previous;
+      for (int i = 0; i < symbols->size(); ++i) {
+        if ((i & 1023) == 0 && *currentGeneration != generation)
+          return {};
+        int length;
+        const char *name = symbols->nameData(i, &length);
+        if (!isSubsequence(foldedPattern, name, length))
+          continue;
+        const QString word = QString::fromUtf8(name, length);
+        if (word == previous || word == prefix || words.contains(word))
+          continue; // already ranked as a word of the document
+        previous = word;
+        int score = matchScore(prefix, word);
+        if (score >= 0)
+          ranked.push_back({score * 16, word});
+      }
+    }
+
+    auto last = ranked.begin() +
+                std::min<std::size_t>(ranked.size(), std::size_t(maxResults));
+    std::partial_sort(ranked.begin(), last, ranked.end(),
+                      [](const Ranked &a, const Ranked &b) {
+                        return a.score != b.score ? a.score > b.score
+                                                  : a.word < b.word;
+                      });
+    QStringList result;
+    for (auto r = ranked.begin(); r != last; ++r)
+      result << r->word;
+    return result;
+  }));
+}
+
+void CompletionEngine::publishResults() {
+  if (m_pendingGeneration != *m_generation)
+    return; // cancelled after the worker finished
+  m_model.setStringList(withServerCompletions(m_watcher.result()));
+  emit completionsReady(m_pendingPrefix, m_model.rowCount());
+}
+
+void CompletionEngine::addServerCompletions(const QString &prefix,
+                                            const QStringList &completions) {
+  m_serverPrefix = prefix;
+  m_serverCompletions = completions;
+  // otherwise they are merged when the worker is done
+  if (prefix != m_pendingPrefix || m_pendingGeneration != *m_generation ||
+      m_watcher.isRunning())
+    return;
+  m_model.setStringList(withServerCompletions(m_model.stringList()));
+  emit completionsReady(prefix, m_model.rowCount());
+}
+
+QStringList
+CompletionEngine::withServerCompletions(const QStringList &ranked) const {
+  if (m_serverPrefix != m_pendingPrefix || m_serverCompletions.isEmpty())
+    return ranked;
+  QStringList result;
+  for (const auto &completion : m_serverCompletions)
+    if (result.size() < m_maxResults && !result.contains(completion) &&
+        matchScore(m_pendingPrefix, completion) >= 0)
+      result << completion;
+  for (const auto &word : ranked)
+    if (result.size() < m_maxResults && !result.contains(word))
+      result << word;
+  return result;
+}
@@ -0,0 +1,67 @@
+#ifndef COMPLETIONENGINE_H
+#define COMPLETIONENGINE_H
+
+#include <QFutureWatcher>
+#include <QHash>
+#include <QObject>
+#include <QStringList>
+#include <QStringListModel>
+#include <atomic>
+#include <memory>
+
+class CppSyntaxHightlighter;
+class QTextBlock;
+class SymbolIndex;
+
+// ranks the words known by the highlighter and the symbols of the system
+// headers against a (fuzzy) prefix on a worker thread and publishes the best
+// few in model()
+class CompletionEngine : public QObject {
+  Q_OBJECT
+public:
+  explicit CompletionEngine(CppSyntaxHightlighter *source,
+                            QObject *parent = nullptr);
+  ~CompletionEngine() override;
+
+  QStringListModel *model() { return &m_model; }
+
+  // starts ranking for prefix, any previous request is superseded
+  void complete(const QString &prefix, const QTextBlock &cursorBlock);
+  void cancel();
+
+  void setSymbolIndex(std::shared_ptr<const SymbolIndex> symbols) {
+    m_symbols = std::move(symbols);
+  }
+  // completions of prefix from a language server, ranked before the words
+  // while prefix is the one being completed
+  void addServerCompletions(const QString &prefix,
+                            const QStringList &completions);
+
+  int maxResults() const { return m_maxResults; }
+  void setMaxResults(int maxResults) { m_maxResults = maxResults; }
+
+  // how well pattern matches word as a subsequence, -1 if it does not
+  static int matchScore(const QString &pattern, const QString &word);
+
+signals:
+  // model() has been updated with the completions of prefix
+  void completionsReady(const QString &prefix, int count);
+
+private:
+  CppSyntaxHightlighter *m_source;
+  std::shared_ptr<const SymbolIndex> m_symbols;
+  QStringListModel m_model;
+  QFutureWatcher<QStringList> m_watcher;
+  QString m_pendingPrefix;
+  QString m_serverPrefix;
+  QStringList m_serverCompletions;
+  quint64 m_pendingGeneration = 0;
+  std::shared_ptr<std::atomic<quint64>> m_generation;
+  int m_maxResults = 50;
+  int m_nearbyRadius = 60; // in blocks
+
+  void publishResults();
+  QStringList withServerCompletions(const QStringList &ranked) const;
+};
+
+#endif // COMPLETIONENGINE_H
@@ -1,136 +1,388 @@
 #include "cppsyntaxhightlighter.h"
+#include "stallwatchdog.h"
+#include "theme.h"
 #include <QDebug>
+#include <QTextBlock>
 #include <QTextDocument>
+#include <algorithm>
+#include <iterator>
+
+HighlighterBlockData::HighlighterBlockData(std::shared_ptr<WordIndex> index)
+    : m_index{std::move(index)} {}
+
+HighlighterBlockData::~HighlighterBlockData() { setWords({}); }
+
+void HighlighterBlockData::setWords(QStringList words) {
+  for (const auto &w : words)
+    ++(*m_index)[w];
+  for (const auto &w : m_words) {
+    auto it = m_index->find(w);
+    if (it != m_index->end() && --*it <= 0)
+      m_index->erase(it);
+  }
+  m_words = std::move(words);
+}
+
+namespace {
+// the block state packs everything the lexer carries over a line break, so
+// QSyntaxHighlighter stops rehighlighting as soon as it is unchanged:
+// bits 0-3 the construct the line ends in, bit 4 set inside a continued
+// directive and bits 8-23 a hash of the delimiter of an open raw string
+enum LexState {
+  Code,
+  BlockComment,
+  LineComment,
+  String,
+  CharLiteral,
+  RawString
+};
+const int lexStateMask = 0xf, directiveFlag = 0x10, delimiterShift = 8;
+
+bool isIdentifierStart(QChar c) { return c.isLetter() || c == '_'; }
+bool isIdentifierPart(QChar c) { return c.isLetterOrNumber() || c == '_'; }
+} // namespace
 
 CppSyntaxHightlighter::CppSyntaxHightlighter(QTextDocument *parent)
-    : QSyntaxHighlighter(parent) {
-  HighlightingRule rule;
-
-  keywordFormat.setForeground(QColor("#90CAF9"));
-  QStringList keywordPatterns;
-  keywordPatterns << "\\bchar\\b"
-                  << "\\bclass\\b"
-                  << "\\bconst\\b"
-                  << "\\bdouble\\b"
-                  << "\\benum\\b"
-                  << "\\bexplicit\\b"
-                  << "\\bfriend\\b"
-                  << "\\binline\\b"
-                  << "\\bint\\b"
-                  << "\\blong\\b"
-                  << "\\bnamespace\\b"
-                  << "\\boperator\\b"
-                  << "\\bprivate\\b"
-                  << "\\bprotected\\b"
-                  << "\\bpublic\\b"
-                  << "\\bshort\\b"
-                  << "\\bsignals\\b"
-                  << "\\bsigned\\b"
-                  << "\\bslots\\b"
-                  << "\\bstatic\\b"
-                  << "\\bstruct\\b"
-                  << "\\btemplate\\b"
-                  << "\\btypedef\\b"
-                  << "\\btypename\\b"
-                  << "\\bunion\\b"
-                  << "\\bunsigned\\b"
-                  << "\\bvirtual\\b"
-                  << "\\bvoid\\b"
-                  << "\\bvolatile\\b"
-                  << "\\bbool\\b";
-  foreach (const QString &pattern, keywordPatterns) {
-    rule.pattern = QRegularExpression(pattern);
-    rule.format = keywordFormat;
-    highlightingRules.append(rule);
+    : QSyntaxHighlighter(parent), m_words{std::make_shared<WordIndex>()} {
+  keywords << "char"
+           << "class"
+           << "const"
+           << "double"
+           << "enum"
+           << "explicit"
+           << "friend"
+           << "inline"
+           << "int"
+           << "long"
+           << "namespace"
+           << "operator"
+           << "private"
+           << "protected"
+           << "public"
+           << "short"
+           << "signals"
+           << "signed"
+           << "slots"
+           << "static"
+           << "struct"
+           << "template"
+           << "typedef"
+           << "typename"
+           << "union"
+           << "unsigned"
+           << "virtual"
+           << "void"
+           << "volatile"
+           << "bool";
+
+  const auto &themeFormats = Theme::dark().tokenFormats;
+  std::copy(std::begin(themeFormats), std::end(themeFormats), tokenFormats);
+}
+
+HighlighterBlockData *CppSyntaxHightlighter::currentBlockData() {
+  auto data = static_cast<HighlighterBlockData *>(currentBlockUserData());
+  if (!data) {
+    data = new HighlighterBlockData(m_words);
+    setCurrentBlockUserData(data);
   }
+  return data;
+}
 
-  classFormat.setForeground(QColor("#9CCC65"));
-  rule.pattern = QRegularExpression("\\bQ[A-Za-z]+\\b");
-  rule.format = classFormat;
-  highlightingRules.append(rule);
-
-  quotationFormat.setForeground(QColor("#E6EE9C"));
-  rule.pattern = QRegularExpression("\".*\"");
-  rule.format = quotationFormat;
-  highlightingRules.append(rule);
-
-  functionFormat.setFontItalic(true);
-  functionFormat.setForeground(QColor("#FFF176"));
-  // rule.pattern = QRegularExpression("\\b[A-Za-z0-9_]+(?=\\()");
-  rule.pattern = QRegularExpression("\\b[A-Za-z0-9_]+(?=\\()");
-  rule.format = functionFormat;
-  highlightingRules.append(rule);
-
-  singleLineCommentFormat.setForeground(Qt::red);
-  rule.pattern = QRegularExpression("//[^\n]*");
-  rule.format = singleLineCommentFormat;
-  highlightingRules.append(rule);
-
-  multiLineCommentFormat.setForeground(Qt::red);
-
-  commentStartExpression = QRegularExpression("/\\*");
-  commentEndExpression = QRegularExpression("\\*/");
-
-  directiveFormat.setForeground(QColor("orange"));
-  rule.pattern = QRegularExpression("^#.*");
-  rule.format = directiveFormat;
-  highlightingRules.append(rule);
+void CppSyntaxHightlighter::format(int start, int length,
+                                   TokenClass tokenClass) {
+  m_tokens.push_back({start, length, tokenClass});
+  if (m_formatting)
+    setFormat(start, length, tokenFormats[tokenClass]);
+}
+
+QVector<Token> CppSyntaxHightlighter::lexWindow(const QString &window) {
+  QVector<Token> tokens;
+  tokens.swap(m_tokens);
+  m_formatting = false;
+  QString delimiter;
+  lex(window, 0, window.size(), Code, false, delimiter);
+  m_formatting = true;
+  tokens.swap(m_tokens);
+  return tokens;
 }
 
 void CppSyntaxHightlighter::updateWordListModel(const QString &text) {
-  const auto terminators = {'(',  ')', ' ', ';', '\r',
-                            '\n', ',', '{', '}', '\t'};
-  for (auto tb = text.cbegin(); tb != text.cend(); tb++) {
-    QChar kTerm = 0;
-    decltype(tb) kEnd = tb;
-    while (kTerm == 0 && kEnd != text.cend()) {
-      for (auto t : terminators)
-        if (*kEnd == t) {
-          kTerm = t;
+  QStringList words;
+  for (int i = 0; i < text.size();) {
+    if (!text[i].isLetter() && text[i] != '_') {
+      ++i;
+      continue;
+    }
+    int end = i + 1;
+    while (end < text.size() &&
+           (text[end].isLetterOrNumber() || text[end] == '_'))
+      ++end;
+    words << text.mid(i, end - i);
+    i = end;
+  }
+
+  currentBlockData()->setWords(std::move(words));
+}
+
+QHash<QString, int> CppSyntaxHightlighter::wordsNear(const QTextBlock &block,
+                                                     int radius) const {
+  QHash<QString, int> nearby;
+  auto visit = [&nearby](const QTextBlock &b, int distance) {
+    auto data = static_cast<HighlighterBlockData *>(b.userData());
+    if (!data)
+      return;
+    for (const auto &w : data->words())
+      if (!nearby.contains(w))
+        nearby.insert(w, distance);
+  };
+
+  visit(block, 0);
+  QTextBlock up = block.previous(), down = block.next();
+  for (int distance = 1; distance <= radius; ++distance) {
+    if (up.isValid()) {
+      visit(up, distance);
+      up = up.previous();
+    }
+    if (down.isValid()) {
+      visit(down, distance);
+      down = down.next();
+    }
+  }
+  return nearby;
+}
+
+qint64 CppSyntaxHightlighter::memoryUsage() const {
+  // a hash node and a string header per word, a list slot per word of a block
+  const qint64 nodeOverhead = 48, stringOverhead = 24;
+  auto stringBytes = [](const QString &s) {
+    return stringOverhead + s.capacity() * qint64(sizeof(QChar));
+  };
+
+  qint64 bytes = 0;
+  for (auto it = m_words->cbegin(); it != m_words->cend(); ++it)
+    bytes += nodeOverhead + stringBytes(it.key());
+  for (auto block = document()->begin(); block.isValid();
+       block = block.next()) {
+    auto data = static_cast<HighlighterBlockData *>(block.userData());
+    if (!data)
+      continue;
+    // the words share their text with the index
+    bytes += sizeof(HighlighterBlockData) +
+             data->words().size() * qint64(sizeof(void *)) +
+             data->tokens().capacity() * qint64(sizeof(Token)) +
+             stringBytes(data->rawDelimiter());
+  }
+  return bytes;
+}
+
+QVector<BlockSnapshot> CppSyntaxHightlighter::snapshot() const {
+  QVector<BlockSnapshot> blocks;
+  blocks.reserve(document()->blockCount());
+  for (auto block = document()->begin(); block.isValid();
+       block = block.next()) {
+    auto data = static_cast<HighlighterBlockData *>(block.userData());
+    if (data)
+      blocks.push_back({block.userState(), data->words(), data->tokens(),
+                        data->rawDelimiter()});
+    else
+      blocks.push_back({block.userState(), {}, {}, {}});
+  }
+  return blocks;
+}
+
+void CppSyntaxHightlighter::restore(QVector<BlockSnapshot> blocks) {
+  m_restored = std::move(blocks);
+}
+
+bool CppSyntaxHightlighter::verifyRestored(QTextBlock block, int count) {
+  bool valid = m_restored.size() == document()->blockCount();
+  m_restored.clear();
+  for (; valid && block.isValid() && count-- > 0; block = block.next()) {
+    auto data = static_cast<HighlighterBlockData *>(block.userData());
+    if (!data) {
+      valid = false;
+      break;
+    }
+    const int restoredState = block.userState();
+    const QVector<Token> restoredTokens = data->tokens();
+    rehighlightBlock(block);
+    valid = block.userState() == restoredState &&
+            data->tokens() == restoredTokens;
+  }
+  if (!valid)
+    rehighlight();
+  return valid;
+}
+
+// formats text from i up to n, starting in state, and returns the state it
+// ends in; delimiter is that of the raw string the lexer is in
+int CppSyntaxHightlighter::lex(const QString &text, int i, int n, int state,
+                               bool directive, QString &delimiter) {
+  while (i < n) {
+    switch (state) {
+    case BlockComment: {
+      int end = text.indexOf("*/", i);
+      int stop = end < 0 ? n : end + 2;
+      format(i, stop - i, Comment);
+      i = stop;
+      if (end >= 0)
+        state = Code;
+      break;
+    }
+    case LineComment:
+      format(i, n - i, Comment);
+      i = n;
+      break;
+    case String:
+    case CharLiteral: {
+      const QChar quote = state == String ? '"' : '\'';
+      int end = i;
+      while (end < n && text[end] != quote)
+        end += text[end] == '\\' ? 2 : 1;
+      int stop = std::min(end + 1, n);
+      if (!directive)
+        format(i, stop - i, Quotation);
+      i = stop;
+      if (end < n)
+        state = Code;
+      break;
+    }
+    case RawString: {
+      int end = text.indexOf(')' + delimiter + '"', i);
+      int stop = end < 0 ? n : end + delimiter.size() + 2;
+      if (!directive)
+        format(i, stop - i, Quotation);
+      i = stop;
+      if (end >= 0) {
+        state = Code;
+        delimiter.clear();
+      }
+      break;
+    }
+    default: {
+      const QChar c = text[i], next = i + 1 < n ? text[i + 1] : QChar();
+      if (c == '/' && next == '/') {
+        state = LineComment;
+      } else if (c == '/' && next == '*') {
+        format(i, 2, Comment);
+        i += 2;
+        state = BlockComment;
+      } else if (c == '"' || c == '\'') {
+        if (!directive)
+          format(i, 1, Quotation);
+        ++i;
+        state = c == '"' ? String : CharLiteral;
+      } else if (c.isDigit()) { // may contain ' as digit separator
+        while (i < n && (isIdentifierPart(text[i]) || text[i] == '.' ||
+                         text[i] == '\''))
+          ++i;
+      } else if (isIdentifierStart(c)) {
+        int end = i + 1;
+        while (end < n && isIdentifierPart(text[end]))
+          ++end;
+        const QString word = text.mid(i, end - i);
+        const QChar after = end < n ? text[end] : QChar();
+        if (after == '"' && (word == "R" || word == "u8R" || word == "uR" ||
+                             word == "UR" || word == "LR")) {
+          // R"delimiter( ... )delimiter", possibly spanning lines
+          int open = text.indexOf('(', end + 1);
+          if (open < 0)
+            open = n - 1;
+          delimiter = text.mid(end + 1, open - end - 1);
+          if (!directive)
+            format(i, open + 1 - i, Quotation);
+          i = open + 1;
+          state = RawString;
           break;
         }
-      if (kTerm == 0)
-        kEnd++;
+        if (directive || ((after == '"' || after == '\'') &&
+                          (word == "u8" || word == "u" || word == "U" ||
+                           word == "L"))) {
+          i = end; // prefix of a literal or a word of a directive
+          break;
+        }
+        if (after == '(')
+          format(i, end - i, Function);
+        else if (keywords.contains(word))
+          format(i, end - i, Keyword);
+        else if (word.size() > 1 && word[0] == 'Q' &&
+                 std::all_of(word.begin() + 1, word.end(),
+                             [](QChar w) { return w.isLetter(); }))
+          format(i, end - i, Class);
+        i = end;
+      } else {
+        ++i;
+      }
     }
-    if (kEnd != text.cend() && kEnd != tb) {
-      auto forInsert = QString(tb, kEnd - tb);
-      if (!m_words.contains(forInsert))
-        m_words << forInsert;
-      tb = kEnd;
     }
   }
-  m_wordsListModel.setStringList(m_words);
-  qDebug() << "Set String list" << m_words.size();
+
+  return state;
 }
 
 void CppSyntaxHightlighter::highlightBlock(const QString &text) {
-  qDebug() << "Matching " << text;
-  updateWordListModel(text);
-  foreach (const HighlightingRule &rule, highlightingRules) {
-    QRegularExpressionMatchIterator matchIterator =
-        rule.pattern.globalMatch(text);
-    while (matchIterator.hasNext()) {
-      QRegularExpressionMatch match = matchIterator.next();
-      setFormat(match.capturedStart(), match.capturedLength(), rule.format);
-    }
+  TraceSpan span("highlight");
+  const int blockNumber =
+      m_restored.isEmpty() ? -1 : currentBlock().blockNumber();
+  if (blockNumber >= 0 && blockNumber < m_restored.size()) {
+    const BlockSnapshot &restored = m_restored[blockNumber];
+    for (const auto &t : restored.tokens)
+      setFormat(t.start, t.length, tokenFormats[t.tokenClass]);
+    currentBlockData()->setWords(restored.words);
+    currentBlockData()->setTokens(restored.tokens);
+    currentBlockData()->setRawDelimiter(restored.rawDelimiter);
+    setCurrentBlockState(restored.state);
+    emit blockHighlighted(currentBlock());
+    return;
   }
-  setCurrentBlockState(0);
-  int startIndex = 0;
-  if (previousBlockState() != 1)
-    startIndex = text.indexOf(commentStartExpression);
-  while (startIndex >= 0) {
-    QRegularExpressionMatch match =
-        commentEndExpression.match(text, startIndex);
-    int endIndex = match.capturedStart();
-    int commentLength = 0;
-    if (endIndex == -1) {
-      setCurrentBlockState(1);
-      commentLength = text.length() - startIndex;
-    } else {
-      commentLength = endIndex - startIndex + match.capturedLength();
-    }
-    setFormat(startIndex, commentLength, multiLineCommentFormat);
-    startIndex =
-        text.indexOf(commentStartExpression, startIndex + commentLength);
+
+  m_tokens.clear();
+  const int previous = std::max(previousBlockState(), 0);
+  int state = previous & lexStateMask;
+  bool directive = previous & directiveFlag;
+  QString delimiter; // of the raw string the line is in
+  if (state == RawString) {
+    auto data = static_cast<HighlighterBlockData *>(
+        currentBlock().previous().userData());
+    delimiter = data ? data->rawDelimiter() : QString();
   }
+
+  if (text.size() > longLineThreshold) {
+    // generated or minified: the line is left to the editor's window and
+    // the state before it is carried over it unchanged, so an edit costs
+    // the same anywhere in it
+    currentBlockData()->setWords({});
+    currentBlockData()->setRawDelimiter(delimiter);
+    setCurrentBlockState(previous);
+    currentBlockData()->setTokens({});
+    emit blockHighlighted(currentBlock());
+    return;
+  }
+  updateWordListModel(text);
+
+  const int n = text.size();
+  int i = 0;
+  if (!directive && state == Code) {
+    while (i < n && text[i].isSpace())
+      ++i;
+    directive = i < n && text[i] == '#';
+  }
+  if (directive) // comments are the only thing drawn over it
+    format(i, n - i, Directive);
+  state = lex(text, i, n, state, directive, delimiter);
+
+  // only a backslash carries line comments, literals and directives over
+  const bool continued = n > 0 && text[n - 1] == '\\';
+  if (!continued && (state == LineComment || state == String ||
+                     state == CharLiteral))
+    state = Code;
+  directive = directive && (continued || state == BlockComment);
+
+  int blockState = state | (directive ? directiveFlag : 0);
+  if (state == RawString)
+    blockState |= int(qHash(delimiter) & 0xffff) << delimiterShift;
+  currentBlockData()->setRawDelimiter(delimiter);
+  setCurrentBlockState(blockState);
+  currentBlockData()->setTokens(m_tokens);
+  emit blockHighlighted(currentBlock());
 }
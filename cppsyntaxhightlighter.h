@@ -1,47 +1,130 @@
 #ifndef CPPSYNTAXHIGHTLIGHTER_H
 #define CPPSYNTAXHIGHTLIGHTER_H
 
-#include <QRegularExpression>
+#include <QHash>
+#include <QSet>
 #include <QStringList>
-#include <QStringListModel>
 #include <QSyntaxHighlighter>
+#include <QTextBlock>
+#include <QTextBlockUserData>
 #include <QTextCharFormat>
 #include <QVector>
+#include <memory>
+
+// word -> number of occurrences in the document
+using WordIndex = QHash<QString, int>;
+
+enum TokenClass : quint8 {
+  Keyword,
+  Class,
+  Quotation,
+  Function,
+  Comment,
+  Directive,
+  TokenClassCount
+};
+
+// a highlighted range of a block
+struct Token {
+  int start, length;
+  TokenClass tokenClass;
+  bool operator==(const Token &o) const {
+    return start == o.start && length == o.length &&
+           tokenClass == o.tokenClass;
+  }
+};
+
+// everything the highlighter derived from a block, enough to restore it
+struct BlockSnapshot {
+  int state;
+  QStringList words;
+  QVector<Token> tokens;
+  QString rawDelimiter;
+};
+
+// words and tokens of a block, words are removed from the index again when
+// the block goes away
+class HighlighterBlockData : public QTextBlockUserData {
+public:
+  explicit HighlighterBlockData(std::shared_ptr<WordIndex> index);
+  ~HighlighterBlockData() override;
+
+  const QStringList &words() const { return m_words; }
+  void setWords(QStringList words);
+  const QVector<Token> &tokens() const { return m_tokens; }
+  void setTokens(QVector<Token> tokens) { m_tokens = std::move(tokens); }
+  // delimiter of the raw string literal still open at the end of the block
+  const QString &rawDelimiter() const { return m_rawDelimiter; }
+  void setRawDelimiter(const QString &delimiter) {
+    m_rawDelimiter = delimiter;
+  }
+
+private:
+  std::shared_ptr<WordIndex> m_index;
+  QStringList m_words;
+  QVector<Token> m_tokens;
+  QString m_rawDelimiter;
+};
 
 class CppSyntaxHightlighter : public QSyntaxHighlighter {
   Q_OBJECT
 public:
   explicit CppSyntaxHightlighter(QTextDocument *parent);
 
-  QStringListModel *wordsListModel() { return &m_wordsListModel; }
+  // implicitly shared snapshot of every word in the document
+  WordIndex words() const { return *m_words; }
+  // words within radius blocks of block -> their distance from it
+  QHash<QString, int> wordsNear(const QTextBlock &block, int radius) const;
+
+  // estimated bytes of the word index and of the data kept per block
+  qint64 memoryUsage() const;
+  // gives back the spare capacity of the word index
+  void squeeze() { m_words->squeeze(); }
+
+  QVector<BlockSnapshot> snapshot() const;
+  // the next blocks highlighted take their states, words and tokens from
+  // blocks instead of being lexed, until verifyRestored is called
+  void restore(QVector<BlockSnapshot> blocks);
+  // lexes count blocks from block again, if they disagree with what was
+  // restored the whole document is rehighlighted
+  bool verifyRestored(QTextBlock block, int count);
+
+  // bumped whenever the rules change, so cached snapshots get outdated
+  static constexpr int rulesVersion = 3;
+
+  // blocks longer than this get no formats, the editor draws the tokens of
+  // the columns around what is on screen over them, lexed by lexWindow
+  static constexpr int longLineThreshold = 10000;
+  // tokens of window as if it started in code, without formatting anything
+  QVector<Token> lexWindow(const QString &window);
+  const QTextCharFormat &tokenFormat(TokenClass tokenClass) const {
+    return tokenFormats[tokenClass];
+  }
 
 protected:
   void highlightBlock(const QString &text) override;
 
 private:
-  struct HighlightingRule {
-    QRegularExpression pattern;
-    QTextCharFormat format;
-  };
-  QVector<HighlightingRule> highlightingRules;
-
-  QRegularExpression commentStartExpression;
-  QRegularExpression commentEndExpression;
-
-  QTextCharFormat keywordFormat;
-  QTextCharFormat classFormat;
-  QTextCharFormat singleLineCommentFormat;
-  QTextCharFormat multiLineCommentFormat;
-  QTextCharFormat quotationFormat;
-  QTextCharFormat functionFormat;
-  QTextCharFormat directiveFormat;
+  QSet<QString> keywords;
+  QTextCharFormat tokenFormats[TokenClassCount];
 
-  QStringList m_words;
-  QStringListModel m_wordsListModel;
+  QVector<Token> m_tokens; // of the block being highlighted
+  QVector<BlockSnapshot> m_restored;
+  bool m_formatting = true; // whether lexed tokens are formatted
+
+  // shared with the block data, which may outlive the highlighter
+  std::shared_ptr<WordIndex> m_words;
 
   void updateWordListModel(const QString &text);
+  void format(int start, int length, TokenClass tokenClass);
+  int lex(const QString &text, int i, int n, int state, bool directive,
+          QString &delimiter);
+  HighlighterBlockData *currentBlockData();
 
 signals:
+  // block got new tokens, also when it changed only because of the blocks
+  // before it
+  void blockHighlighted(const QTextBlock &block);
 
 public slots:
 };
@@ -0,0 +1,100 @@
+#include "diffpanel.h"
+#include "bufferdiff.h"
+#include <QHBoxLayout>
+#include <QTextBlock>
+#include <QTextDocument>
+
+namespace {
+enum Role { LineRole = Qt::UserRole };
+}
+
+DiffPanel::DiffPanel(BufferDiff *diff, QTextDocument *document,
+                     QWidget *parent)
+    : QWidget(parent), m_diff{diff}, m_document{document} {
+  m_base.addItems({tr("Changes since saved"), tr("Changes since last build")});
+
+  auto top = new QHBoxLayout;
+  top->addWidget(&m_base);
+  top->addWidget(&m_status, 1);
+  m_layout.setContentsMargins(0, 0, 0, 0);
+  m_layout.addLayout(top);
+  m_layout.addWidget(&m_hunks);
+  setLayout(&m_layout);
+
+  m_hunks.setHeaderHidden(true);
+  m_hunks.setUniformRowHeights(true);
+  m_hunks.setFont(document->defaultFont());
+
+  connect(&m_base, QOverload<int>::of(&QComboBox::currentIndexChanged),
+          [this](int index) { emit baseChanged(Base(index)); });
+  connect(&m_hunks, &QTreeWidget::itemActivated,
+          [this](QTreeWidgetItem *item) {
+            if (item->data(0, LineRole).isValid())
+              emit lineRequested(item->data(0, LineRole).toInt());
+          });
+  // typing changes the diff on every key, the list follows a little later
+  m_refresh.setSingleShot(true);
+  m_refresh.setInterval(200);
+  connect(&m_refresh, &QTimer::timeout, this, &DiffPanel::refresh);
+  connect(diff, &BufferDiff::changed, this, [this]() {
+    if (isVisible())
+      m_refresh.start();
+  });
+}
+
+void DiffPanel::showEvent(QShowEvent *event) {
+  refresh();
+  QWidget::showEvent(event);
+}
+
+void DiffPanel::refresh() {
+  m_hunks.clear();
+  if (!m_diff->hasBase()) {
+    m_status.setText(base() == SavedFile ? tr("Not saved yet")
+                                         : tr("Not built yet"));
+    return;
+  }
+
+  const auto &hunks = m_diff->hunks();
+  const QStringList &baseLines = m_diff->baseLines();
+  int added = 0, removed = 0;
+  for (const auto &hunk : hunks) {
+    added += hunk.newCount;
+    removed += hunk.oldCount;
+  }
+  m_status.setText(tr("%1 changes, +%2 -%3, diffed in %4 ms")
+                       .arg(hunks.size())
+                       .arg(added)
+                       .arg(removed)
+                       .arg(m_diff->lastDiffNsecs() / 1e6, 0, 'f', 2));
+
+  const QColor removedColor("#E57373"), addedColor("#81C784");
+  for (int h = 0; h < std::min(hunks.size(), maxHunksShown); ++h) {
+    const auto &hunk = hunks[h];
+    const int line = hunk.newStart + 1;
+    auto item = new QTreeWidgetItem(
+        &m_hunks, {QString("@@ -%1,%2 +%3,%4 @@")
+                       .arg(hunk.oldStart + 1)
+                       .arg(hunk.oldCount)
+                       .arg(line)
+                       .arg(hunk.newCount)});
+    item->setData(0, LineRole, line);
+    for (int i = 0; i < hunk.oldCount; ++i) {
+      auto row = new QTreeWidgetItem(
+          item, {'-' + baseLines.value(hunk.oldStart + i)});
+      row->setForeground(0, removedColor);
+      row->setData(0, LineRole, line);
+    }
+    QTextBlock block = m_document->findBlockByNumber(hunk.newStart);
+    for (int i = 0; i < hunk.newCount && block.isValid();
+         ++i, block = block.next()) {
+      auto row = new QTreeWidgetItem(item, {'+' + block.text()});
+      row->setForeground(0, addedColor);
+      row->setData(0, LineRole, line + i);
+    }
+  }
+  if (hunks.size() > maxHunksShown)
+    new QTreeWidgetItem(&m_hunks, {tr("%1 more changes not shown")
+                                       .arg(hunks.size() - maxHunksShown)});
+  m_hunks.expandAll();
+}
@@ -0,0 +1,47 @@
+#ifndef DIFFPANEL_H
+#define DIFFPANEL_H
+
+#include <QComboBox>
+#include <QLabel>
+#include <QTimer>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+#include <QWidget>
+
+class BufferDiff;
+class QTextDocument;
+
+// the hunks of a BufferDiff with the lines they remove and add, refreshed
+// while the panel is shown
+class DiffPanel : public QWidget {
+  Q_OBJECT
+public:
+  enum Base { SavedFile, LastBuild };
+
+  DiffPanel(BufferDiff *diff, QTextDocument *document,
+            QWidget *parent = nullptr);
+
+  Base base() const { return Base(m_base.currentIndex()); }
+
+  static constexpr int maxHunksShown = 500;
+
+signals:
+  void baseChanged(Base base);
+  void lineRequested(int line); // 1 based
+
+protected:
+  void showEvent(QShowEvent *event) override;
+
+private:
+  BufferDiff *m_diff;
+  QTextDocument *m_document;
+  QVBoxLayout m_layout;
+  QComboBox m_base;
+  QLabel m_status;
+  QTreeWidget m_hunks;
+  QTimer m_refresh;
+
+  void refresh();
+};
+
+#endif // DIFFPANEL_H
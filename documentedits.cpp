@@ -0,0 +1,37 @@
+#include "documentedits.h"
+#include <QTextCursor>
+#include <QTextDocument>
+#include <algorithm>
+
+DocumentEdits *DocumentEdits::of(QTextDocument *document) {
+  auto edits = document->findChild<DocumentEdits *>(
+      QString(), Qt::FindDirectChildrenOnly);
+  return edits ? edits : new DocumentEdits(document);
+}
+
+DocumentEdits::DocumentEdits(QTextDocument *document)
+    : QObject(document), m_document{document},
+      m_text{document->toPlainText()} {
+  connect(document, &QTextDocument::contentsChange, this,
+          &DocumentEdits::contentsChange);
+}
+
+void DocumentEdits::contentsChange(int position, int charsRemoved,
+                                   int charsAdded) {
+  // a change of the whole document counts its implicit last paragraph
+  // separator, which is not part of the text
+  const int removed = std::min(charsRemoved, m_text.size() - position),
+            added = std::min(charsAdded,
+                             m_document->characterCount() - 1 - position);
+  if (position < 0 || removed < 0 || added < 0)
+    return;
+  QTextCursor cursor(m_document);
+  cursor.setPosition(position);
+  cursor.setPosition(position + added, QTextCursor::KeepAnchor);
+  QString text = cursor.selectedText();
+  text.replace(QChar::ParagraphSeparator, '\n');
+  if (removed == added && m_text.midRef(position, removed) == text)
+    return; // only formats changed
+  m_text.replace(position, removed, text);
+  emit edited(position, charsRemoved, charsAdded);
+}
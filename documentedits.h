@@ -0,0 +1,32 @@
+#ifndef DOCUMENTEDITS_H
+#define DOCUMENTEDITS_H
+
+#include <QObject>
+#include <QString>
+
+class QTextDocument;
+
+// the edits of a document's text: QTextDocument::contentsChange is also
+// emitted when only formats change, e.g. for every block the highlighter
+// formats, so the text is kept aside and changes that leave it as it was are
+// not passed on
+class DocumentEdits : public QObject {
+  Q_OBJECT
+public:
+  // the one instance of document, created along with the first listener
+  static DocumentEdits *of(QTextDocument *document);
+
+signals:
+  // the arguments of the contentsChange that changed the text
+  void edited(int position, int charsRemoved, int charsAdded);
+
+private:
+  explicit DocumentEdits(QTextDocument *document);
+
+  QTextDocument *m_document;
+  QString m_text; // as it was after the last edit, lines end in '\n'
+
+  void contentsChange(int position, int charsRemoved, int charsAdded);
+};
+
+#endif // DOCUMENTEDITS_H
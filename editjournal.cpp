@@ -0,0 +1,270 @@
+#include "editjournal.h"
+#include "documentedits.h"
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QLockFile>
+#include <QStandardPaths>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QThread>
+#include <QTimer>
+#include <algorithm>
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+#ifdef Q_OS_WIN
+#include <io.h>
+#define NOMINMAX // std::min and std::max are used below
+#include <windows.h>
+#endif
+
+namespace {
+const quint32 journalMagic = 0x51434a4e; // QCJN
+// the writer flushes at least this often, even if the gui thread is stuck
+const unsigned long flushInterval = 500; // ms
+const qint64 minCheckpointDistance = 1024 * 1024;
+
+QString journalDirectory() {
+  return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) +
+         "/journals";
+}
+
+// a lock only goes stale with the process holding it, however old it is
+std::unique_ptr<QLockFile> journalLock(const QString &journalPath) {
+  auto lock = std::make_unique<QLockFile>(journalPath + ".lock");
+  lock->setStaleLockTime(0);
+  return lock;
+}
+
+// a record is its payload size, a checksum and the payload, so a write torn
+// by a crash is recognized and ignored
+QByteArray frame(const QByteArray &payload) {
+  QByteArray record;
+  QDataStream out(&record, QIODevice::WriteOnly);
+  out << quint32(payload.size()) << qChecksum(payload.constData(),
+                                              uint(payload.size()));
+  record += payload;
+  return record;
+}
+
+// flushing only hands the data to the system, which may still lose it
+bool sync(QFile &file) {
+  if (!file.flush())
+    return false;
+#if defined(Q_OS_UNIX)
+  return ::fsync(file.handle()) == 0;
+#elif defined(Q_OS_WIN)
+  return FlushFileBuffers(HANDLE(_get_osfhandle(file.handle())));
+#else
+  return true;
+#endif
+}
+} // namespace
+
+EditJournal::EditJournal(QTextDocument *document, QObject *parent)
+    : QObject(parent), m_document{document}, m_path{journalPath()} {
+  connect(DocumentEdits::of(m_document), &DocumentEdits::edited, this,
+          &EditJournal::contentsChange);
+}
+
+EditJournal::~EditJournal() {
+  if (!m_writer)
+    return;
+  {
+    QMutexLocker lock(&m_mutex);
+    m_stopping = true;
+    m_wake.wakeOne();
+  }
+  m_writer->wait();
+  QFile::remove(m_path);
+  m_lock->unlock();
+}
+
+QString EditJournal::journalPath() {
+  return journalDirectory() +
+         QString("/journal-%1.qcj").arg(QCoreApplication::applicationPid());
+}
+
+void EditJournal::start(const QString &fileName, bool clean,
+                        const QString &superseded) {
+  QDir().mkpath(QFileInfo(m_path).absolutePath());
+  m_lock = journalLock(m_path);
+  if (!m_lock->tryLock(0))
+    qWarning() << "Cannot lock the edit journal" << m_path;
+  m_started = true;
+  m_superseded = superseded;
+  checkpoint(fileName, clean);
+  m_writer.reset(QThread::create([this]() { writeLoop(); }));
+  m_writer->start(QThread::LowPriority);
+}
+
+void EditJournal::checkpoint(const QString &fileName, bool clean) {
+  m_checkpointPending = false;
+  if (!m_started)
+    return;
+  m_fileName = fileName;
+  QByteArray payload;
+  QDataStream out(&payload, QIODevice::WriteOnly);
+  out.setVersion(QDataStream::Qt_5_9);
+  out << journalMagic << quint8(Checkpoint) << clean << fileName
+      << m_document->toPlainText();
+  m_sinceCheckpoint = 0;
+  append(payload, true);
+}
+
+void EditJournal::contentsChange(int position, int charsRemoved,
+                                 int charsAdded) {
+  if (!m_started)
+    return;
+  QTextCursor cursor(m_document);
+  cursor.setPosition(position);
+  cursor.setPosition(
+      std::min(position + charsAdded, m_document->characterCount() - 1),
+      QTextCursor::KeepAnchor);
+  QByteArray payload;
+  QDataStream out(&payload, QIODevice::WriteOnly);
+  out.setVersion(QDataStream::Qt_5_9);
+  out << quint8(Edit) << qint32(position) << qint32(charsRemoved)
+      << cursor.selectedText().replace(QChar::ParagraphSeparator, '\n');
+  append(payload, false);
+
+  // once replaying the edits would cost more than the text itself, the
+  // journal starts over from the text, after the current edit is done
+  m_sinceCheckpoint += payload.size();
+  if (m_sinceCheckpoint >
+          std::max(minCheckpointDistance,
+                   qint64(m_document->characterCount()) * 2) &&
+      !m_checkpointPending) {
+    m_checkpointPending = true;
+    QTimer::singleShot(0, this, [this]() {
+      if (m_checkpointPending)
+        checkpoint(m_fileName, false);
+    });
+  }
+}
+
+void EditJournal::append(const QByteArray &payload, bool truncate) {
+  QMutexLocker lock(&m_mutex);
+  if (truncate) {
+    m_pending.clear(); // superseded by the checkpoint
+    m_truncate = true;
+  }
+  m_pending += frame(payload);
+}
+
+void EditJournal::writeLoop() {
+  QFile file(m_path);
+  for (bool stopping = false; !stopping;) {
+    QByteArray batch;
+    bool truncate;
+    {
+      QMutexLocker lock(&m_mutex);
+      if (m_pending.isEmpty() && !m_stopping)
+        m_wake.wait(&m_mutex, flushInterval);
+      batch.swap(m_pending);
+      truncate = m_truncate;
+      m_truncate = false;
+      stopping = m_stopping;
+    }
+    if (batch.isEmpty())
+      continue;
+    if (truncate || !file.isOpen()) {
+      file.close();
+      if (!file.open(truncate ? QFile::WriteOnly | QFile::Truncate
+                              : QFile::WriteOnly | QFile::Append)) {
+        qWarning() << "Cannot write the edit journal" << m_path;
+        continue;
+      }
+    }
+    // a checkpoint replaces what the journal had, so it has to be on disk
+    // before anything relies on it
+    if (file.write(batch) != batch.size() ||
+        !(truncate ? sync(file) : file.flush())) {
+      qWarning() << "Cannot write the edit journal" << m_path;
+      continue;
+    }
+    if (truncate && !m_superseded.isEmpty()) {
+      QFile::remove(m_superseded);
+      m_superseded.clear();
+    }
+  }
+}
+
+bool EditJournal::recover(QString *fileName, QString *text,
+                          QString *journal) {
+  const QFileInfoList journals =
+      QDir(journalDirectory())
+          .entryInfoList({"journal-*.qcj"}, QDir::Files, QDir::Time);
+  bool recovered = false;
+  for (const QFileInfo &journal : journals) {
+    const QString path = journal.absoluteFilePath();
+    const auto lock = journalLock(path);
+    if (path == QFileInfo(journalPath()).absoluteFilePath() ||
+        !lock->tryLock(0))
+      continue; // a session that is still running
+    // the newest unsaved edits are recovered, older ones wait for the next
+    // start, and the journals of sessions that left nothing are cleaned up
+    QString journalFileName, journalText;
+    const bool unsaved = read(path, &journalFileName, &journalText);
+    if (unsaved && recovered)
+      continue;
+    if (unsaved) {
+      // it is removed by the session taking it over, once the recovered
+      // text is safe in that session's journal
+      *fileName = journalFileName;
+      *text = journalText;
+      *journal = path;
+      recovered = true;
+      continue;
+    }
+    QFile::remove(path);
+  }
+  return recovered;
+}
+
+bool EditJournal::read(const QString &path, QString *fileName,
+                       QString *text) {
+  QFile file(path);
+  if (!file.open(QFile::ReadOnly))
+    return false;
+  QDataStream records(&file);
+
+  bool clean = true, started = false;
+  while (!records.atEnd()) {
+    quint32 size;
+    quint16 checksum;
+    records >> size >> checksum;
+    QByteArray payload(int(std::min<quint32>(size, quint32(file.size()))),
+                       Qt::Uninitialized);
+    if (records.status() != QDataStream::Ok ||
+        records.readRawData(payload.data(), payload.size()) != int(size) ||
+        qChecksum(payload.constData(), uint(size)) != checksum)
+      break; // torn by the crash, everything before it is intact
+
+    QDataStream in(payload);
+    in.setVersion(QDataStream::Qt_5_9);
+    quint8 type;
+    if (!started) {
+      quint32 magic;
+      in >> magic >> type;
+      if (magic != journalMagic || type != Checkpoint)
+        return false;
+      in >> clean >> *fileName >> *text;
+      started = true;
+      continue;
+    }
+    qint32 position, removed;
+    QString inserted;
+    in >> type >> position >> removed >> inserted;
+    if (in.status() != QDataStream::Ok || type != Edit || position < 0 ||
+        position > text->size())
+      break;
+    text->replace(position, removed, inserted);
+    clean = false;
+  }
+  return started && !clean;
+}
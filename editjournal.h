@@ -0,0 +1,65 @@
+#ifndef EDITJOURNAL_H
+#define EDITJOURNAL_H
+
+#include <QByteArray>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QWaitCondition>
+#include <memory>
+
+class QLockFile;
+class QTextDocument;
+class QThread;
+
+// append only log of the edits to a document, so unsaved work survives a
+// crash; a writer thread flushes the edits in batches and the log restarts
+// from a checkpoint of the whole text once it outgrows the text. Every
+// session has a journal of its own, locked for as long as it runs
+class EditJournal : public QObject {
+  Q_OBJECT
+public:
+  explicit EditJournal(QTextDocument *document, QObject *parent = nullptr);
+  // a clean shutdown leaves no journal behind
+  ~EditJournal() override;
+
+  // the journal of this process
+  static QString journalPath();
+  // the text and file name left by the latest crashed session with unsaved
+  // edits and the journal they came from, false if there is none; journals
+  // still locked by a running session are left alone, those of crashed
+  // sessions without unsaved edits are removed
+  static bool recover(QString *fileName, QString *text, QString *journal);
+
+  // starts journaling over whatever journal is there, clean if the document
+  // matches fileName on disk; the journal superseded by it, if any, is
+  // removed once the first checkpoint is on disk
+  void start(const QString &fileName, bool clean,
+             const QString &superseded = QString());
+  // the document was loaded from or saved to fileName
+  void checkpoint(const QString &fileName, bool clean = true);
+
+private:
+  enum RecordType : quint8 { Checkpoint, Edit };
+
+  QTextDocument *m_document;
+  QString m_path, m_fileName;
+  QString m_superseded; // only touched by the writer once it runs
+  std::unique_ptr<QLockFile> m_lock; // held from start() on
+  bool m_started = false, m_checkpointPending = false;
+  qint64 m_sinceCheckpoint = 0; // bytes journaled after the last checkpoint
+
+  // handed to the writer thread
+  QMutex m_mutex;
+  QWaitCondition m_wake;
+  QByteArray m_pending;
+  bool m_truncate = false, m_stopping = false;
+  std::unique_ptr<QThread> m_writer;
+
+  void contentsChange(int position, int charsRemoved, int charsAdded);
+  void append(const QByteArray &payload, bool truncate);
+  void writeLoop();
+  static bool read(const QString &path, QString *fileName, QString *text);
+};
+
+#endif // EDITJOURNAL_H
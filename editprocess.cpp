@@ -2,11 +2,57 @@
 #include <QDebug>
 #include <QKeyEvent>
 #include <QPlainTextEdit>
+#include <QSocketNotifier>
+#include <QTextCodec>
+#include <QTextDecoder>
+#include <algorithm>
+#ifdef Q_OS_UNIX
+#include <cerrno>
+#include <fcntl.h>
+#ifdef Q_OS_MACOS
+#include <util.h>
+#else
+#include <pty.h>
+#endif
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
 
 EditProcess::EditProcess(QWidget *parent)
     : QProcess(parent), m_textEdit{new QPlainTextEdit}
 // zm_textEdit(std::make_shared<QPlainTextEdit>(parent))
 {
+  // the terminal is set up before the fork and drained before the program
+  // is reported as finished
+  QObject::connect(this, &EditProcess::stateChanged,
+                   [this](QProcess::ProcessState state) {
+                     if (state == QProcess::Starting && m_ptyMode &&
+                         !openPty())
+                       qDebug() << "No pseudo terminal, running on pipes";
+                   });
+  QObject::connect(this, &EditProcess::started, [this]() {
+#ifdef Q_OS_UNIX
+    if (m_ptySlave >= 0) { // the child has its own copy
+      ::close(m_ptySlave);
+      m_ptySlave = -1;
+    }
+#endif
+  });
+  QObject::connect(
+      this,
+      static_cast<void (EditProcess::*)(int, QProcess::ExitStatus)>(
+          &EditProcess::finished),
+      [this]() {
+        readPty();
+        closePty();
+      });
+  QObject::connect(this, &EditProcess::errorOccurred,
+                   [this](QProcess::ProcessError error) {
+                     if (error == QProcess::FailedToStart)
+                       closePty();
+                   });
+
   QObject::connect(this, &EditProcess::readyReadStandardOutput, [this]() {
     m_textEdit->insertPlainText(readAllStandardOutput());
   });
@@ -27,9 +73,146 @@ EditProcess::EditProcess(QWidget *parent)
   m_textEdit->installEventFilter(this);
 }
 
+EditProcess::~EditProcess() { closePty(); }
+
 bool EditProcess::eventFilter(QObject *, QEvent *event) {
   if (event->type() == QEvent::KeyPress) {
-    write(dynamic_cast<QKeyEvent *>(event)->text().toUtf8());
+    send(dynamic_cast<QKeyEvent *>(event)->text().toUtf8());
+  }
+  return false;
+}
+
+void EditProcess::send(const QByteArray &input) {
+#ifdef Q_OS_UNIX
+  if (m_ptyMaster >= 0) {
+    for (qint64 done = 0; done < input.size();) {
+      const auto n = ::write(m_ptyMaster, input.constData() + done,
+                             size_t(input.size() - done));
+      if (n < 0 && errno != EINTR)
+        return;
+      done += std::max<qint64>(n, 0);
+    }
+    return;
+  }
+#endif
+  write(input);
+}
+
+bool EditProcess::openPty() {
+#ifdef Q_OS_UNIX
+  closePty();
+  if (::openpty(&m_ptyMaster, &m_ptySlave, nullptr, nullptr, nullptr) < 0) {
+    m_ptyMaster = m_ptySlave = -1;
+    return false;
   }
+  // the console shows what is typed itself, and keeps '\n' line breaks
+  termios attributes;
+  ::tcgetattr(m_ptySlave, &attributes);
+  attributes.c_lflag &= tcflag_t(~(ECHO | ECHOE | ECHOK | ECHONL));
+  attributes.c_oflag &= tcflag_t(~OPOST);
+  attributes.c_cc[VERASE] = '\b';
+  ::tcsetattr(m_ptySlave, TCSANOW, &attributes);
+  ::fcntl(m_ptyMaster, F_SETFL, ::fcntl(m_ptyMaster, F_GETFL) | O_NONBLOCK);
+  ::fcntl(m_ptyMaster, F_SETFD, FD_CLOEXEC);
+
+  m_decoder.reset(QTextCodec::codecForName("UTF-8")->makeDecoder());
+  m_escape.clear();
+  m_ptyNotifier = std::make_unique<QSocketNotifier>(m_ptyMaster,
+                                                    QSocketNotifier::Read);
+  QObject::connect(m_ptyNotifier.get(), &QSocketNotifier::activated,
+                   [this]() { readPty(); });
+  return true;
+#else
   return false;
+#endif
+}
+
+void EditProcess::closePty() {
+#ifdef Q_OS_UNIX
+  m_ptyNotifier.reset();
+  if (m_ptySlave >= 0)
+    ::close(m_ptySlave);
+  if (m_ptyMaster >= 0)
+    ::close(m_ptyMaster);
+  m_ptyMaster = m_ptySlave = -1;
+#endif
+}
+
+void EditProcess::readPty() {
+#ifdef Q_OS_UNIX
+  if (m_ptyMaster < 0)
+    return;
+  char buffer[4096];
+  for (;;) {
+    const auto n = ::read(m_ptyMaster, buffer, sizeof buffer);
+    if (n > 0) {
+      appendTerminalOutput(QByteArray(buffer, int(n)));
+      continue;
+    }
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n == 0 || errno != EAGAIN) // EIO once the program has exited
+      m_ptyNotifier->setEnabled(false);
+    return;
+  }
+#endif
+}
+
+void EditProcess::appendTerminalOutput(const QByteArray &bytes) {
+  // only plain text, line breaks and backspaces are shown, escape sequences
+  // for colours, cursor movement or titles are dropped
+  const QByteArray data = m_escape + bytes;
+  m_escape.clear();
+  QByteArray text;
+  auto flush = [this, &text]() {
+    if (text.isEmpty())
+      return;
+    m_textEdit->moveCursor(QTextCursor::End);
+    m_textEdit->insertPlainText(m_decoder->toUnicode(text));
+    text.clear();
+  };
+  for (int i = 0; i < data.size(); ++i) {
+    const char c = data[i];
+    if (c == '\x1b') {
+      int end = -1;
+      if (i + 1 < data.size() && data[i + 1] == '[') { // CSI
+        for (int j = i + 2; j < data.size() && end < 0; ++j)
+          if (data[j] >= 0x40 && data[j] <= 0x7e)
+            end = j;
+      } else if (i + 1 < data.size() && data[i + 1] == ']') { // OSC
+        for (int j = i + 2; j < data.size() && end < 0; ++j)
+          if (data[j] == '\a' ||
+              (data[j] == '\\' && data[j - 1] == '\x1b'))
+            end = j;
+      } else if (i + 1 < data.size()) {
+        end = i + 1;
+      }
+      if (end < 0) { // the rest of it comes with the next read
+        m_escape = data.mid(i);
+        break;
+      }
+      i = end;
+    } else if (c == '\b') {
+      flush();
+      m_textEdit->textCursor().deletePreviousChar();
+    } else if (c == '\n' || c == '\t' || uchar(c) >= 0x20) {
+      text += c;
+    }
+  }
+  flush();
+}
+
+void EditProcess::setupChildProcess() {
+#ifdef Q_OS_UNIX
+  // in the forked child: the terminal becomes its controlling terminal and
+  // replaces the pipes QProcess set up
+  if (m_ptySlave < 0)
+    return;
+  ::setsid();
+  ::ioctl(m_ptySlave, TIOCSCTTY, 0);
+  ::dup2(m_ptySlave, STDIN_FILENO);
+  ::dup2(m_ptySlave, STDOUT_FILENO);
+  ::dup2(m_ptySlave, STDERR_FILENO);
+  ::close(m_ptySlave);
+#endif
 }
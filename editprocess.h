@@ -5,14 +5,24 @@
 #include <memory>
 
 class QPlainTextEdit;
+class QSocketNotifier;
+class QTextDecoder;
 
 // a Process with plainTextEdit as output and input window
 class EditProcess : public QProcess {
   Q_OBJECT
 public:
   explicit EditProcess(QWidget *parent = nullptr);
+  ~EditProcess() override;
   QPointer<QPlainTextEdit> edit() { return m_textEdit; }
 
+  // runs the next program on a pseudo terminal instead of pipes, so its
+  // stdio is line buffered and prompts show up at once; only on unix
+  void setPtyMode(bool enabled) { m_ptyMode = enabled; }
+  bool ptyMode() const { return m_ptyMode; }
+  // input for the program, through the terminal in pty mode
+  void send(const QByteArray &input);
+
 signals:
 
 public slots:
@@ -21,8 +31,20 @@ private:
   // std::shared_ptr<QPlainTextEdit> m_textEdit;
   QPointer<QPlainTextEdit> m_textEdit;
 
+  bool m_ptyMode = false;
+  int m_ptyMaster = -1, m_ptySlave = -1;
+  std::unique_ptr<QSocketNotifier> m_ptyNotifier;
+  std::unique_ptr<QTextDecoder> m_decoder;
+  QByteArray m_escape; // control sequence cut by the end of a read
+
+  bool openPty();
+  void closePty();
+  void readPty();
+  void appendTerminalOutput(const QByteArray &bytes);
+
 protected:
   bool eventFilter(QObject *, QEvent *event) override;
+  void setupChildProcess() override;
 };
 
 #endif // EDITPROCESS_H
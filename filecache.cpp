@@ -0,0 +1,131 @@
+#include "filecache.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace {
+const quint32 cacheMagic = 0x51434643; // QCFC
+const quint32 cacheVersion = 2;
+
+QByteArray contentHash(const QByteArray &contents) {
+  return QCryptographicHash::hash(contents, QCryptographicHash::Md5);
+}
+
+qint64 modificationTime(const QString &fileName) {
+  return QFileInfo(fileName).lastModified().toMSecsSinceEpoch();
+}
+} // namespace
+
+QString FileCache::cachePath(const QString &fileName) {
+  const QByteArray path = QFileInfo(fileName).absoluteFilePath().toUtf8();
+  return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+         "/files/" +
+         QCryptographicHash::hash(path, QCryptographicHash::Md5).toHex() +
+         ".qcc";
+}
+
+bool FileCache::read(const QString &fileName, const QByteArray &contents,
+                     QVector<BlockSnapshot> &blocks) {
+  QFile file(cachePath(fileName));
+  if (!file.open(QFile::ReadOnly))
+    return false;
+  QDataStream in(&file);
+  in.setVersion(QDataStream::Qt_5_9);
+
+  quint32 magic, version;
+  qint32 rulesVersion;
+  QString path;
+  qint64 mtime, size;
+  QByteArray hash;
+  in >> magic >> version >> rulesVersion >> path >> mtime >> size;
+  // cheap checks first, the contents are only hashed if they could match
+  if (in.status() != QDataStream::Ok || magic != cacheMagic ||
+      version != cacheVersion ||
+      rulesVersion != CppSyntaxHightlighter::rulesVersion ||
+      path != QFileInfo(fileName).absoluteFilePath() ||
+      mtime != modificationTime(fileName) || size != contents.size())
+    return false;
+  in >> hash;
+  if (hash != contentHash(contents))
+    return false;
+
+  // words are interned, blocks refer to them by index
+  QStringList wordTable;
+  qint32 blockCount;
+  in >> wordTable >> blockCount;
+  if (in.status() != QDataStream::Ok || blockCount < 0)
+    return false;
+
+  blocks.clear();
+  blocks.reserve(blockCount);
+  for (qint32 b = 0; b < blockCount && in.status() == QDataStream::Ok; ++b) {
+    BlockSnapshot block;
+    quint32 wordCount, tokenCount;
+    in >> block.state >> wordCount;
+    for (quint32 w = 0; w < wordCount && in.status() == QDataStream::Ok;
+         ++w) {
+      quint32 id;
+      in >> id;
+      if (id >= quint32(wordTable.size()))
+        return false;
+      block.words << wordTable[int(id)];
+    }
+    in >> tokenCount;
+    for (quint32 t = 0; t < tokenCount && in.status() == QDataStream::Ok;
+         ++t) {
+      qint32 start, length;
+      quint8 tokenClass;
+      in >> start >> length >> tokenClass;
+      if (tokenClass >= TokenClassCount)
+        return false;
+      block.tokens.push_back({start, length, TokenClass(tokenClass)});
+    }
+    in >> block.rawDelimiter;
+    blocks.push_back(std::move(block));
+  }
+  return in.status() == QDataStream::Ok;
+}
+
+bool FileCache::write(const QString &fileName, const QByteArray &contents,
+                      const QVector<BlockSnapshot> &blocks) {
+  const QString path = cachePath(fileName);
+  QDir().mkpath(QFileInfo(path).path());
+  QSaveFile file(path);
+  if (!file.open(QFile::WriteOnly))
+    return false;
+  QDataStream out(&file);
+  out.setVersion(QDataStream::Qt_5_9);
+
+  out << cacheMagic << cacheVersion
+      << qint32(CppSyntaxHightlighter::rulesVersion)
+      << QFileInfo(fileName).absoluteFilePath() << modificationTime(fileName)
+      << qint64(contents.size()) << contentHash(contents);
+
+  QStringList wordTable;
+  QHash<QString, quint32> wordIds;
+  for (const auto &block : blocks)
+    for (const auto &w : block.words)
+      if (!wordIds.contains(w)) {
+        wordIds.insert(w, quint32(wordTable.size()));
+        wordTable << w;
+      }
+  out << wordTable << qint32(blocks.size());
+
+  for (const auto &block : blocks) {
+    out << qint32(block.state) << quint32(block.words.size());
+    for (const auto &w : block.words)
+      out << wordIds.value(w);
+    out << quint32(block.tokens.size());
+    for (const auto &t : block.tokens)
+      out << qint32(t.start) << qint32(t.length) << quint8(t.tokenClass);
+    out << block.rawDelimiter;
+  }
+  return file.commit();
+}
@@ -0,0 +1,23 @@
+#ifndef FILECACHE_H
+#define FILECACHE_H
+
+#include "cppsyntaxhightlighter.h"
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+// on disk copy of what the highlighter derived from a file, so reopening an
+// unchanged file does not lex it again
+class FileCache {
+public:
+  // where the cache of fileName lives
+  static QString cachePath(const QString &fileName);
+
+  // blocks cached for fileName, if they were saved for exactly contents
+  static bool read(const QString &fileName, const QByteArray &contents,
+                   QVector<BlockSnapshot> &blocks);
+  static bool write(const QString &fileName, const QByteArray &contents,
+                    const QVector<BlockSnapshot> &blocks);
+};
+
+#endif // FILECACHE_H
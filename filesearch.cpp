@@ -0,0 +1,290 @@
+#include "filesearch.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QSet>
+#include <QTextStream>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+// files with a NUL byte in their first few KiB are taken as binary
+const qint64 binaryProbeSize = 8192;
+const int maxPreviewLength = 200;
+
+bool isIgnored(const QFileInfo &file) {
+  static const QSet<QString> binarySuffixes = {
+      "o",   "obj", "exe", "dll", "so",  "a",   "lib", "dylib", "pdb",
+      "png", "jpg", "gif", "bmp", "ico", "pdf", "zip", "gz",    "7z"};
+  return binarySuffixes.contains(file.suffix().toLower());
+}
+
+// simple case folding, one code point for another, so positions in the
+// folded text are those in text
+QString caseFolded(QString text) {
+  QChar *c = text.data(), *end = c + text.size();
+  for (; c != end; ++c) {
+    if (c->isHighSurrogate() && c + 1 != end && c[1].isLowSurrogate()) {
+      const uint folded =
+          QChar::toCaseFolded(QChar::surrogateToUcs4(c[0], c[1]));
+      *c++ = QChar(QChar::highSurrogate(folded));
+      *c = QChar(QChar::lowSurrogate(folded));
+    } else {
+      *c = c->toCaseFolded();
+    }
+  }
+  return text;
+}
+
+// a pattern of a .gitignore file, matched against paths relative to the
+// directory of that file
+struct IgnoreRule {
+  QString base; // with a trailing '/'
+  QRegularExpression path;
+  bool negated, directoryOnly;
+};
+
+// the glob of a .gitignore pattern as a regular expression: '*' and '?' stay
+// within a path component, "**" crosses them
+QString globToRegex(const QString &glob) {
+  QString regex;
+  for (int i = 0; i < glob.size(); ++i) {
+    const QChar c = glob[i];
+    if (c == '*' && glob.midRef(i, 3) == "**/") {
+      regex += "(?:.*/)?";
+      i += 2;
+    } else if (c == '*' && glob.midRef(i, 2) == "**") {
+      regex += ".*";
+      ++i;
+    } else if (c == '*') {
+      regex += "[^/]*";
+    } else if (c == '?') {
+      regex += "[^/]";
+    } else if (c == '[' && glob.indexOf(']', i + 2) > 0) {
+      const int end = glob.indexOf(']', i + 2);
+      QString set = glob.mid(i + 1, end - i - 1);
+      if (set.startsWith('!'))
+        set[0] = '^';
+      regex += '[' + set.replace('\\', "\\\\") + ']';
+      i = end;
+    } else if (c == '\\' && i + 1 < glob.size()) {
+      regex += QRegularExpression::escape(glob[++i]);
+    } else {
+      regex += QRegularExpression::escape(c);
+    }
+  }
+  return regex;
+}
+
+// the rules of directory's .gitignore, a subset of git's syntax: negation,
+// directory only and anchored patterns, and the globs above
+void readIgnoreRules(const QString &directory, QVector<IgnoreRule> &rules) {
+  QFile file(directory + "/.gitignore");
+  if (!file.open(QFile::ReadOnly))
+    return;
+  QTextStream in(&file);
+  while (!in.atEnd()) {
+    QString pattern = in.readLine();
+    while (pattern.endsWith(' ') && !pattern.endsWith("\\ "))
+      pattern.chop(1);
+    if (pattern.isEmpty() || pattern.startsWith('#'))
+      continue;
+    IgnoreRule rule{directory + '/', {}, false, false};
+    if (pattern.startsWith('!')) {
+      rule.negated = true;
+      pattern.remove(0, 1);
+    }
+    if (pattern.endsWith('/')) {
+      rule.directoryOnly = true;
+      pattern.chop(1);
+    }
+    // a pattern with a slash before its end is relative to the directory,
+    // one without matches a name at any depth below it
+    const bool anchored = pattern.contains('/');
+    if (pattern.startsWith('/'))
+      pattern.remove(0, 1);
+    if (pattern.isEmpty())
+      continue;
+    rule.path.setPattern((anchored ? "^" : "^(?:.*/)?") +
+                         globToRegex(pattern) + '$');
+    rules << rule;
+  }
+}
+
+// the last rule that matches decides, as in git
+bool isGitIgnored(const QFileInfo &entry, const QVector<IgnoreRule> &rules) {
+  const QString path = entry.filePath();
+  bool ignored = false;
+  for (const IgnoreRule &rule : rules) {
+    if (ignored == !rule.negated || (rule.directoryOnly && !entry.isDir()) ||
+        !path.startsWith(rule.base))
+      continue;
+    if (rule.path.match(path.midRef(rule.base.size())).hasMatch())
+      ignored = !rule.negated;
+  }
+  return ignored;
+}
+
+// the files below directory, hidden files and directories are skipped, as
+// are those the .gitignore files on the way exclude
+QStringList listFiles(const QString &directory,
+                      const std::atomic<bool> &cancelled) {
+  QStringList files;
+  // directories still to list, with the rules that apply within them
+  QVector<QPair<QString, QVector<IgnoreRule>>> pending{
+      {QDir::cleanPath(directory), {}}};
+  while (!pending.isEmpty() && !cancelled) {
+    const auto next = pending.takeLast();
+    QVector<IgnoreRule> rules = next.second;
+    readIgnoreRules(next.first, rules);
+    const QFileInfoList entries = QDir(next.first).entryInfoList(
+        QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+    for (const QFileInfo &entry : entries) {
+      if (isGitIgnored(entry, rules))
+        continue;
+      if (entry.isDir() && !entry.isSymLink())
+        pending.append({entry.filePath(), rules});
+      else if (!entry.isDir() && !isIgnored(entry))
+        files << entry.filePath();
+    }
+  }
+  return files;
+}
+} // namespace
+
+FileSearch::FileSearch(QObject *parent)
+    : QObject(parent), m_cancelled{std::make_shared<std::atomic<bool>>()} {
+  connect(&m_watcher, &QFutureWatcher<int>::finished, [this]() {
+    if (!*m_cancelled)
+      emit finished(m_watcher.result());
+  });
+}
+
+FileSearch::~FileSearch() {
+  cancel();
+  m_watcher.waitForFinished();
+}
+
+void FileSearch::cancel() { *m_cancelled = true; }
+
+void FileSearch::start(const QString &directory, const QString &pattern,
+                       Qt::CaseSensitivity cs) {
+  cancel();
+  m_watcher.waitForFinished();
+  if (pattern.isEmpty())
+    return;
+  m_cancelled = std::make_shared<std::atomic<bool>>(false);
+
+  auto cancelled = m_cancelled;
+  const QByteArray utf8 = pattern.toUtf8();
+  m_watcher.setFuture(QtConcurrent::run([=]() {
+    const QStringList files = listFiles(directory, *cancelled);
+    // the pool hands files out to idle threads one at a time, so a few big
+    // files do not leave the other cores waiting
+    std::atomic<int> scanned{0};
+    QtConcurrent::blockingMap(files, [&](const QString &fileName) {
+      if (*cancelled)
+        return;
+      QFile file(fileName);
+      if (!file.open(QIODevice::ReadOnly) || file.size() == 0)
+        return;
+      const uchar *data = file.map(0, file.size());
+      if (!data)
+        return;
+      const auto matches = scan(fileName, data, file.size(), utf8, cs);
+      file.unmap(const_cast<uchar *>(data));
+      ++scanned;
+      // reported from the gui thread, unless cancelled meanwhile
+      if (!matches.isEmpty())
+        QMetaObject::invokeMethod(
+            this,
+            [this, cancelled, matches]() {
+              if (!*cancelled)
+                emit matchesFound(matches);
+            },
+            Qt::QueuedConnection);
+    });
+    return scanned.load();
+  }));
+}
+
+QVector<FileSearch::Match>
+FileSearch::scan(const QString &fileName, const uchar *data, qint64 size,
+                 const QByteArray &pattern, Qt::CaseSensitivity cs) {
+  QVector<Match> result;
+  const qint64 m = pattern.size();
+  // folded characters may take other byte counts, so the size check is for
+  // exact matches only
+  if (m == 0 || (cs == Qt::CaseSensitive && size < m) ||
+      std::memchr(data, 0, std::min(size, binaryProbeSize)))
+    return result;
+
+  if (cs == Qt::CaseInsensitive) {
+    // case folding needs the characters, so the text is decoded first
+    const QString text = QString::fromUtf8(
+        reinterpret_cast<const char *>(data), int(size));
+    const QString folded = caseFolded(text),
+                  foldedPattern = caseFolded(QString::fromUtf8(pattern));
+    int line = 1, lineStart = 0, counted = 0;
+    for (int i = folded.indexOf(foldedPattern); i >= 0;) {
+      for (; counted < i; ++counted)
+        if (text[counted] == '\n') {
+          ++line;
+          lineStart = counted + 1;
+        }
+      int end = text.indexOf('\n', i);
+      if (end < 0)
+        end = text.size();
+      result.push_back(
+          {fileName, line, i - lineStart + 1,
+           text.mid(lineStart, std::min(end - lineStart, maxPreviewLength))
+               .trimmed()});
+      i = folded.indexOf(foldedPattern, end); // one match per line
+    }
+    return result;
+  }
+
+  // Boyer-Moore-Horspool over the raw bytes
+  const auto *p = reinterpret_cast<const uchar *>(pattern.constData());
+  qint64 skip[256];
+  std::fill(std::begin(skip), std::end(skip), m);
+  for (qint64 k = 0; k + 1 < m; ++k)
+    skip[p[k]] = m - 1 - k;
+
+  int line = 1;
+  qint64 lineStart = 0, counted = 0; // newlines are counted up to counted
+  for (qint64 i = 0; i + m <= size;) {
+    qint64 j = m - 1;
+    while (j >= 0 && data[i + j] == p[j])
+      --j;
+    if (j >= 0) {
+      i += skip[data[i + m - 1]];
+      continue;
+    }
+
+    for (; counted < i; ++counted)
+      if (data[counted] == '\n') {
+        ++line;
+        lineStart = counted + 1;
+      }
+    auto lineEnd = static_cast<const uchar *>(
+        std::memchr(data + i, '\n', size_t(size - i)));
+    const qint64 end = lineEnd ? lineEnd - data : size;
+    // the editor counts columns in utf16 units, not in bytes
+    const int column =
+        QString::fromUtf8(reinterpret_cast<const char *>(data + lineStart),
+                          int(i - lineStart))
+            .size() +
+        1;
+    result.push_back(
+        {fileName, line, column,
+         QString::fromUtf8(reinterpret_cast<const char *>(data + lineStart),
+                           int(std::min<qint64>(end - lineStart,
+                                                maxPreviewLength)))
+             .trimmed()});
+    i = end; // one match per line is enough for the list
+  }
+  return result;
+}
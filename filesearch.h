@@ -0,0 +1,47 @@
+#ifndef FILESEARCH_H
+#define FILESEARCH_H
+
+#include <QFutureWatcher>
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include <memory>
+
+// searches every text file below a directory for a literal pattern, skipping
+// hidden ones and those its .gitignore files exclude; the files are mapped
+// and scanned in parallel and matches are reported per file as soon as it is
+// done
+class FileSearch : public QObject {
+  Q_OBJECT
+public:
+  struct Match {
+    QString fileName;
+    int line, column; // 1 based, column in utf16 units as in QString
+    QString text;     // the matching line
+  };
+
+  explicit FileSearch(QObject *parent = nullptr);
+  ~FileSearch() override;
+
+  // starts searching directory, any running search is cancelled
+  void start(const QString &directory, const QString &pattern,
+             Qt::CaseSensitivity cs);
+  void cancel();
+  bool isRunning() const { return m_watcher.isRunning(); }
+
+  // matches of pattern in the mapped bytes of a file, empty if it is binary
+  static QVector<Match> scan(const QString &fileName, const uchar *data,
+                             qint64 size, const QByteArray &pattern,
+                             Qt::CaseSensitivity cs);
+
+signals:
+  void matchesFound(const QVector<FileSearch::Match> &matches);
+  void finished(int filesScanned);
+
+private:
+  QFutureWatcher<int> m_watcher;
+  std::shared_ptr<std::atomic<bool>> m_cancelled;
+};
+
+#endif // FILESEARCH_H
@@ -0,0 +1,125 @@
+#include "findbar.h"
+#include "textsearch.h"
+#include <QKeyEvent>
+#include <QPlainTextEdit>
+#include <QTextCursor>
+
+FindBar::FindBar(QPlainTextEdit *editor, TextSearch *search, QWidget *parent)
+    : QWidget(parent), m_editor{editor}, m_search{search},
+      m_caseSensitive{tr("Match case")}, m_previous{tr("Previous")},
+      m_next{tr("Next")}, m_replaceOne{tr("Replace")},
+      m_replaceAll{tr("Replace All")} {
+  m_find.setPlaceholderText(tr("Find"));
+  m_replace.setPlaceholderText(tr("Replace with"));
+  m_mode.addItems({tr("Text"), tr("Whole word"), tr("Regular expression")});
+
+  m_layout.setContentsMargins(5, 2, 5, 2);
+  m_layout.addWidget(&m_find, 0, 0);
+  m_layout.addWidget(&m_mode, 0, 1);
+  m_layout.addWidget(&m_caseSensitive, 0, 2);
+  m_layout.addWidget(&m_previous, 0, 3);
+  m_layout.addWidget(&m_next, 0, 4);
+  m_layout.addWidget(&m_status, 0, 5);
+  m_layout.addWidget(&m_replace, 1, 0);
+  m_layout.addWidget(&m_replaceOne, 1, 3);
+  m_layout.addWidget(&m_replaceAll, 1, 4);
+  m_layout.setColumnStretch(0, 1);
+  setLayout(&m_layout);
+
+  connect(&m_find, &QLineEdit::textChanged, this, &FindBar::updateQuery);
+  connect(&m_mode, QOverload<int>::of(&QComboBox::currentIndexChanged), this,
+          &FindBar::updateQuery);
+  connect(&m_caseSensitive, &QCheckBox::toggled, this, &FindBar::updateQuery);
+  connect(&m_find, &QLineEdit::returnPressed, [this]() { findNext(); });
+  connect(&m_next, &QPushButton::clicked, [this]() { findNext(); });
+  connect(&m_previous, &QPushButton::clicked, [this]() { findNext(true); });
+  connect(&m_replace, &QLineEdit::returnPressed, this,
+          &FindBar::replaceCurrent);
+  connect(&m_replaceOne, &QPushButton::clicked, this,
+          &FindBar::replaceCurrent);
+  connect(&m_replaceAll, &QPushButton::clicked, [this]() {
+    const bool updates = m_editor->updatesEnabled();
+    m_editor->setUpdatesEnabled(false);
+    const int count = m_search->replaceAll(m_replace.text());
+    m_editor->setUpdatesEnabled(updates);
+    m_status.setText(tr("%1 replaced").arg(count));
+  });
+
+  // counted in the background, so the total may grow for a while
+  connect(m_search, &TextSearch::matchCountChanged, this,
+          [this](int count, bool complete) {
+            if (!m_search->isActive())
+              m_status.setText(m_search->errorString());
+            else
+              m_status.setText(complete ? tr("%1 matches").arg(count)
+                                        : tr("%1+ matches").arg(count));
+          });
+
+  hide();
+}
+
+void FindBar::showFind() {
+  setReplaceVisible(false);
+  show();
+  const QString selected = m_editor->textCursor().selectedText();
+  if (!selected.isEmpty() && !selected.contains(QChar::ParagraphSeparator))
+    m_find.setText(selected);
+  m_find.setFocus();
+  m_find.selectAll();
+  updateQuery();
+}
+
+void FindBar::showReplace() {
+  showFind();
+  setReplaceVisible(true);
+}
+
+void FindBar::setReplaceVisible(bool visible) {
+  m_replace.setVisible(visible);
+  m_replaceOne.setVisible(visible);
+  m_replaceAll.setVisible(visible);
+}
+
+void FindBar::keyPressEvent(QKeyEvent *event) {
+  if (event->key() == Qt::Key_Escape) {
+    hide();
+    m_editor->setFocus();
+    return;
+  }
+  QWidget::keyPressEvent(event);
+}
+
+void FindBar::hideEvent(QHideEvent *event) {
+  m_search->clear(); // drops the highlighted matches
+  QWidget::hideEvent(event);
+}
+
+void FindBar::updateQuery() {
+  m_search->setQuery(m_find.text(),
+                     static_cast<TextSearch::Mode>(m_mode.currentIndex()),
+                     m_caseSensitive.isChecked() ? Qt::CaseSensitive
+                                                 : Qt::CaseInsensitive);
+}
+
+void FindBar::findNext(bool backward) {
+  const QTextCursor cursor = m_editor->textCursor();
+  const auto match = m_search->findNext(
+      backward ? cursor.selectionStart() : cursor.selectionEnd(), backward);
+  if (!match.isValid())
+    return;
+  QTextCursor found(m_editor->document());
+  found.setPosition(match.position);
+  found.setPosition(match.position + match.length, QTextCursor::KeepAnchor);
+  m_editor->setTextCursor(found);
+}
+
+void FindBar::replaceCurrent() {
+  // the selection is replaced only if it is a match, then moves to the next
+  QTextCursor cursor = m_editor->textCursor();
+  const auto match = m_search->findNext(cursor.selectionStart());
+  if (match.isValid() && cursor.hasSelection() &&
+      match.position == cursor.selectionStart() &&
+      match.position + match.length == cursor.selectionEnd())
+    cursor.insertText(m_search->replacementFor(match, m_replace.text()));
+  findNext();
+}
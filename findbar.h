@@ -0,0 +1,45 @@
+#ifndef FINDBAR_H
+#define FINDBAR_H
+
+#include <QCheckBox>
+#include <QComboBox>
+#include <QGridLayout>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QWidget>
+
+class QPlainTextEdit;
+class TextSearch;
+
+// find and replace fields below the editor, driving a TextSearch
+class FindBar : public QWidget {
+  Q_OBJECT
+public:
+  FindBar(QPlainTextEdit *editor, TextSearch *search,
+          QWidget *parent = nullptr);
+
+  void showFind();
+  void showReplace();
+
+protected:
+  void keyPressEvent(QKeyEvent *event) override;
+  void hideEvent(QHideEvent *event) override;
+
+private:
+  QPlainTextEdit *m_editor;
+  TextSearch *m_search;
+  QGridLayout m_layout;
+  QLineEdit m_find, m_replace;
+  QComboBox m_mode;
+  QCheckBox m_caseSensitive;
+  QPushButton m_previous, m_next, m_replaceOne, m_replaceAll;
+  QLabel m_status;
+
+  void updateQuery();
+  void findNext(bool backward = false);
+  void replaceCurrent();
+  void setReplaceVisible(bool visible);
+};
+
+#endif // FINDBAR_H
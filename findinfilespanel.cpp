@@ -0,0 +1,95 @@
+#include "findinfilespanel.h"
+#include <QDir>
+#include <QFileDialog>
+#include <QHBoxLayout>
+#include <QHeaderView>
+
+namespace {
+enum Role { FileRole = Qt::UserRole, LineRole, ColumnRole };
+}
+
+FindInFilesPanel::FindInFilesPanel(QWidget *parent)
+    : QWidget(parent), m_caseSensitive{tr("Match case")}, m_start{tr("Find")} {
+  m_pattern.setPlaceholderText(tr("Find in files"));
+  m_directory.setText(QDir::currentPath());
+  auto browse = new QPushButton(tr("..."));
+  connect(browse, &QPushButton::clicked, [this]() {
+    const auto directory = QFileDialog::getExistingDirectory(
+        this, tr("Search Directory"), m_directory.text());
+    if (!directory.isEmpty())
+      setDirectory(directory);
+  });
+
+  auto fields = new QHBoxLayout;
+  fields->addWidget(&m_pattern, 2);
+  fields->addWidget(&m_directory, 3);
+  fields->addWidget(browse);
+  fields->addWidget(&m_caseSensitive);
+  fields->addWidget(&m_start);
+  fields->addWidget(&m_status);
+  m_layout.setContentsMargins(0, 0, 0, 0);
+  m_layout.addLayout(fields);
+  m_layout.addWidget(&m_results);
+  setLayout(&m_layout);
+
+  m_results.setHeaderHidden(true);
+  m_results.setUniformRowHeights(true); // keeps thousands of rows cheap
+
+  connect(&m_pattern, &QLineEdit::returnPressed, this,
+          &FindInFilesPanel::start);
+  connect(&m_start, &QPushButton::clicked, this, &FindInFilesPanel::start);
+  connect(&m_search, &FileSearch::matchesFound, this,
+          &FindInFilesPanel::addMatches);
+  connect(&m_search, &FileSearch::finished, [this](int filesScanned) {
+    m_status.setText(tr("%1 matches in %2 files")
+                         .arg(m_matchCount)
+                         .arg(filesScanned));
+  });
+  connect(&m_results, &QTreeWidget::itemActivated,
+          [this](QTreeWidgetItem *item) {
+            if (item->data(0, LineRole).isValid())
+              emit openRequested(item->data(0, FileRole).toString(),
+                                 item->data(0, LineRole).toInt(),
+                                 item->data(0, ColumnRole).toInt());
+          });
+}
+
+void FindInFilesPanel::setDirectory(const QString &directory) {
+  m_directory.setText(directory);
+}
+
+void FindInFilesPanel::activate(const QString &text) {
+  if (!text.isEmpty() && !text.contains(QChar::ParagraphSeparator))
+    m_pattern.setText(text);
+  m_pattern.setFocus();
+  m_pattern.selectAll();
+}
+
+void FindInFilesPanel::start() {
+  m_results.clear();
+  m_fileItems.clear();
+  m_matchCount = 0;
+  m_status.setText(tr("Searching..."));
+  m_search.start(m_directory.text(), m_pattern.text(),
+                 m_caseSensitive.isChecked() ? Qt::CaseSensitive
+                                             : Qt::CaseInsensitive);
+}
+
+void FindInFilesPanel::addMatches(const QVector<FileSearch::Match> &matches) {
+  const QDir base(m_directory.text());
+  auto &fileItem = m_fileItems[matches.front().fileName];
+  if (!fileItem) {
+    fileItem = new QTreeWidgetItem(
+        &m_results, {base.relativeFilePath(matches.front().fileName)});
+    fileItem->setExpanded(true);
+  }
+  for (const auto &match : matches) {
+    auto item = new QTreeWidgetItem(
+        fileItem, {QString("%1: %2").arg(match.line).arg(match.text)});
+    item->setData(0, FileRole, match.fileName);
+    item->setData(0, LineRole, match.line);
+    item->setData(0, ColumnRole, match.column);
+  }
+  m_matchCount += matches.size();
+  m_status.setText(tr("%1 matches...").arg(m_matchCount));
+}
@@ -0,0 +1,43 @@
+#ifndef FINDINFILESPANEL_H
+#define FINDINFILESPANEL_H
+
+#include "filesearch.h"
+#include <QCheckBox>
+#include <QHash>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+#include <QWidget>
+
+// pattern and directory fields over the matches of a FileSearch, grouped by
+// file as they stream in
+class FindInFilesPanel : public QWidget {
+  Q_OBJECT
+public:
+  explicit FindInFilesPanel(QWidget *parent = nullptr);
+
+  void setDirectory(const QString &directory);
+  // focuses the pattern, prefilled with text if it is not empty
+  void activate(const QString &text);
+
+signals:
+  void openRequested(const QString &fileName, int line, int column);
+
+private:
+  FileSearch m_search;
+  QVBoxLayout m_layout;
+  QLineEdit m_pattern, m_directory;
+  QCheckBox m_caseSensitive;
+  QPushButton m_start;
+  QTreeWidget m_results;
+  QLabel m_status;
+  QHash<QString, QTreeWidgetItem *> m_fileItems;
+  int m_matchCount = 0;
+
+  void start();
+  void addMatches(const QVector<FileSearch::Match> &matches);
+};
+
+#endif // FINDINFILESPANEL_H
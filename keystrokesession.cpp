@@ -0,0 +1,177 @@
+#include "keystrokesession.h"
+#include "sourcecodeeditor.h"
+#include <QAbstractItemView>
+#include <QApplication>
+#include <QEventLoop>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QKeyEvent>
+#include <QSaveFile>
+#include <QTimer>
+#include <algorithm>
+
+namespace {
+const int sessionVersion = 1;
+
+double percentile(QVector<double> values, double p) {
+  if (values.isEmpty())
+    return 0;
+  std::sort(values.begin(), values.end());
+  return values[std::min<int>(values.size() - 1, int(p * values.size()))];
+}
+
+// sees the viewport being painted while the replayer waits for a frame
+class PaintWatcher : public QObject {
+public:
+  bool painted = false;
+
+protected:
+  bool eventFilter(QObject *, QEvent *event) override {
+    if (event->type() == QEvent::Paint)
+      painted = true;
+    return false;
+  }
+};
+} // namespace
+
+bool KeystrokeSession::save(const QString &path) const {
+  QSaveFile file(path);
+  if (!file.open(QFile::WriteOnly))
+    return false;
+  const QJsonObject header{{"version", sessionVersion},
+                           {"file", fileName},
+                           {"position", position}};
+  file.write(QJsonDocument(header).toJson(QJsonDocument::Compact) + '\n');
+  for (const auto &key : keys) {
+    const QJsonObject line{
+        {"t", double(key.time)},
+        {"type", key.type == QEvent::KeyPress ? "press" : "release"},
+        {"key", key.key},
+        {"modifiers", key.modifiers},
+        {"text", key.text},
+        {"repeat", key.autoRepeat}};
+    file.write(QJsonDocument(line).toJson(QJsonDocument::Compact) + '\n');
+  }
+  return file.commit();
+}
+
+bool KeystrokeSession::load(const QString &path) {
+  QFile file(path);
+  if (!file.open(QFile::ReadOnly))
+    return false;
+  const QJsonObject header = QJsonDocument::fromJson(file.readLine()).object();
+  if (header.value("version").toInt() != sessionVersion)
+    return false;
+  fileName = header.value("file").toString();
+  position = header.value("position").toInt();
+  keys.clear();
+  while (!file.atEnd()) {
+    const QJsonObject line = QJsonDocument::fromJson(file.readLine()).object();
+    if (line.isEmpty())
+      continue;
+    keys.push_back({qint64(line.value("t").toDouble()),
+                    line.value("type").toString() == "press"
+                        ? QEvent::KeyPress
+                        : QEvent::KeyRelease,
+                    line.value("key").toInt(), line.value("modifiers").toInt(),
+                    line.value("text").toString(),
+                    line.value("repeat").toBool()});
+  }
+  return true;
+}
+
+KeystrokeRecorder::KeystrokeRecorder(SourceCodeEditor *editor, QObject *parent)
+    : QObject(parent), m_editor{editor} {}
+
+void KeystrokeRecorder::start() {
+  m_session = {m_editor->fileName(), m_editor->textCursor().position(), {}};
+  m_clock.start();
+  m_recording = true;
+  qApp->installEventFilter(this);
+}
+
+void KeystrokeRecorder::stop() {
+  qApp->removeEventFilter(this);
+  m_recording = false;
+}
+
+bool KeystrokeRecorder::eventFilter(QObject *watched, QEvent *event) {
+  if ((event->type() == QEvent::KeyPress ||
+       event->type() == QEvent::KeyRelease) &&
+      event->spontaneous() &&
+      (watched == m_editor || (m_editor->completer() &&
+                               watched == m_editor->completer()->popup()))) {
+    auto key = static_cast<QKeyEvent *>(event);
+    m_session.keys.push_back({m_clock.elapsed(), event->type(), key->key(),
+                              int(key->modifiers()), key->text(),
+                              key->isAutoRepeat()});
+  }
+  return false;
+}
+
+bool KeystrokeReplayer::replay(const KeystrokeSession &session,
+                               Latencies *latencies,
+                               const QString &fileName) {
+  const QString file = fileName.isEmpty() ? session.fileName : fileName;
+  if (!file.isEmpty() && m_editor->loadFile(file))
+    return false;
+  QTextCursor cursor = m_editor->textCursor();
+  cursor.setPosition(
+      qBound(0, session.position, m_editor->document()->characterCount() - 1));
+  m_editor->setTextCursor(cursor);
+  m_editor->setFocus();
+  QApplication::processEvents();
+
+  PaintWatcher watcher;
+  m_editor->viewport()->installEventFilter(&watcher);
+  *latencies = {};
+  QElapsedTimer clock, latency;
+  clock.start();
+  for (const auto &recorded : session.keys) {
+    // the timers of the editor, completion and builds run in between
+    if (clock.elapsed() < recorded.time) {
+      QEventLoop pause;
+      QTimer::singleShot(int(recorded.time - clock.elapsed()), &pause,
+                         &QEventLoop::quit);
+      pause.exec();
+    }
+
+    QWidget *target = m_editor;
+    if (m_editor->completer() && m_editor->completer()->popup()->isVisible())
+      target = m_editor->completer()->popup();
+    QKeyEvent event(recorded.type, recorded.key,
+                    Qt::KeyboardModifiers(recorded.modifiers), recorded.text,
+                    recorded.autoRepeat);
+    watcher.painted = false;
+    latency.start();
+    QApplication::sendEvent(target, &event);
+    if (recorded.type != QEvent::KeyPress)
+      continue;
+    latencies->input.push_back(latency.nsecsElapsed() / 1e6);
+
+    // the frame is painted once the posted update request is processed
+    while (!watcher.painted && latency.elapsed() < paintTimeoutMs)
+      QApplication::processEvents();
+    if (watcher.painted)
+      latencies->paint.push_back(latency.nsecsElapsed() / 1e6);
+    else
+      ++latencies->unpainted;
+  }
+  m_editor->viewport()->removeEventFilter(&watcher);
+  return true;
+}
+
+QString KeystrokeReplayer::Latencies::summary() const {
+  auto line = [](const char *name, const QVector<double> &values) {
+    return QString("%1: p50 %2 ms, p99 %3 ms, max %4 ms over %5 keys")
+        .arg(name)
+        .arg(percentile(values, 0.5), 0, 'f', 2)
+        .arg(percentile(values, 0.99), 0, 'f', 2)
+        .arg(percentile(values, 1.0), 0, 'f', 2)
+        .arg(values.size());
+  };
+  return line("Key to input handled", input) + '\n' +
+         line("Key to frame painted", paint) +
+         QString("\n%1 keys painted nothing").arg(unpainted);
+}
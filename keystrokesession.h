@@ -0,0 +1,80 @@
+#ifndef KEYSTROKESESSION_H
+#define KEYSTROKESESSION_H
+
+#include <QElapsedTimer>
+#include <QEvent>
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+class SourceCodeEditor;
+
+// a key event of an editing session, at ms since the session started
+struct RecordedKey {
+  qint64 time;
+  QEvent::Type type; // KeyPress or KeyRelease
+  int key;
+  int modifiers;
+  QString text;
+  bool autoRepeat;
+};
+
+// what the file was and where the cursor stood when recording started,
+// followed by the keys typed; stored as json lines
+struct KeystrokeSession {
+  QString fileName;
+  int position = 0;
+  QVector<RecordedKey> keys;
+
+  bool save(const QString &path) const;
+  bool load(const QString &path);
+};
+
+// records the keys typed into an editor, including those going to its
+// completer popup; only events from the window system are taken, the ones
+// the popup forwards to the editor would otherwise be recorded twice
+class KeystrokeRecorder : public QObject {
+  Q_OBJECT
+public:
+  explicit KeystrokeRecorder(SourceCodeEditor *editor,
+                             QObject *parent = nullptr);
+
+  void start();
+  void stop();
+  bool isRecording() const { return m_recording; }
+  const KeystrokeSession &session() const { return m_session; }
+
+protected:
+  bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+  SourceCodeEditor *m_editor;
+  KeystrokeSession m_session;
+  QElapsedTimer m_clock;
+  bool m_recording = false;
+};
+
+// feeds a session into an editor at its recorded pace and measures how long
+// each key press takes to be handled and to reach the screen
+class KeystrokeReplayer {
+public:
+  struct Latencies {
+    QVector<double> input, paint; // ms per key press
+    int unpainted = 0;            // presses that drew nothing
+
+    QString summary() const;
+  };
+
+  explicit KeystrokeReplayer(SourceCodeEditor *editor) : m_editor{editor} {}
+
+  // loads the session's file, or fileName instead, and replays it
+  bool replay(const KeystrokeSession &session, Latencies *latencies,
+              const QString &fileName = {});
+
+  static constexpr int paintTimeoutMs = 100;
+
+private:
+  SourceCodeEditor *m_editor;
+};
+
+#endif // KEYSTROKESESSION_H
@@ -0,0 +1,397 @@
+#include "languageclient.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QStandardPaths>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QUrl>
+
+namespace {
+const int changeDelay = 50; // ms, edits within it go out as one didChange
+const int shutdownWait = 500; // ms
+
+// the semantic token types asked for, the theme has colours for some
+const char *const tokenTypes[] = {
+    "namespace", "type",     "class",         "enum",      "interface",
+    "struct",    "concept",  "typeParameter", "parameter", "variable",
+    "property",  "function", "method",        "macro",     "enumMember"};
+
+QString uri(const QString &fileName) {
+  return QUrl::fromLocalFile(QFileInfo(fileName).absoluteFilePath())
+      .toString();
+}
+
+QString hoverText(const QJsonValue &contents) {
+  if (contents.isString())
+    return contents.toString();
+  if (contents.isObject()) // MarkupContent or a MarkedString
+    return contents.toObject().value("value").toString();
+  QStringList parts;
+  for (const auto &part : contents.toArray())
+    parts << hoverText(part);
+  return parts.join("\n\n");
+}
+} // namespace
+
+LanguageClient::LanguageClient(QTextDocument *document, QObject *parent)
+    : QObject(parent), m_document{document} {
+  m_process.setStandardErrorFile(QProcess::nullDevice());
+  connect(&m_process, &QProcess::readyReadStandardOutput, this,
+          &LanguageClient::readMessages);
+  connect(&m_process,
+          QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this,
+          [this](int exitCode) {
+            m_ready = m_opened = false;
+            m_pending.clear();
+            if (!m_stopping)
+              emit stopped(tr("%1 exited with code %2")
+                               .arg(m_process.program())
+                               .arg(exitCode));
+          });
+  connect(&m_process, &QProcess::errorOccurred, this,
+          [this](QProcess::ProcessError error) {
+            if (error == QProcess::FailedToStart)
+              emit stopped(m_process.errorString());
+          });
+  connect(m_document, &QTextDocument::contentsChange, this,
+          &LanguageClient::contentsChanged);
+  m_flushTimer.setSingleShot(true);
+  m_flushTimer.setInterval(changeDelay);
+  connect(&m_flushTimer, &QTimer::timeout, this,
+          &LanguageClient::flushChanges);
+}
+
+LanguageClient::~LanguageClient() { stop(); }
+
+QString LanguageClient::findServer() {
+  return QStandardPaths::findExecutable("clangd");
+}
+
+void LanguageClient::start(const QString &program, const QString &fileName) {
+  stop();
+  m_uri = uri(fileName);
+  m_stopping = false;
+  m_process.start(program, {"--log=error"});
+
+  QJsonArray types;
+  for (const char *type : tokenTypes)
+    types << type;
+  const QJsonObject capabilities{
+      {"textDocument",
+       QJsonObject{
+           {"synchronization", QJsonObject{{"didSave", false}}},
+           {"completion",
+            QJsonObject{{"completionItem",
+                         QJsonObject{{"snippetSupport", false}}}}},
+           {"hover",
+            QJsonObject{{"contentFormat", QJsonArray{"plaintext"}}}},
+           {"publishDiagnostics", QJsonObject{{"versionSupport", true}}},
+           {"semanticTokens",
+            QJsonObject{{"requests", QJsonObject{{"range", true},
+                                                 {"full", false}}},
+                        {"tokenTypes", types},
+                        {"tokenModifiers", QJsonArray{}},
+                        {"formats", QJsonArray{"relative"}}}}}}};
+  request("initialize",
+          {{"processId", QCoreApplication::applicationPid()},
+           {"rootUri", uri(QDir::currentPath())},
+           {"capabilities", capabilities}},
+          [this](const QJsonValue &result) {
+            initialized(result.toObject().value("capabilities").toObject());
+          },
+          true);
+}
+
+void LanguageClient::stop() {
+  if (m_process.state() == QProcess::NotRunning)
+    return;
+  m_stopping = true;
+  if (m_ready) {
+    close();
+    request("shutdown", {}, [](const QJsonValue &) {}, true);
+    notify("exit", {});
+    m_process.closeWriteChannel();
+    if (m_process.waitForFinished(shutdownWait))
+      return;
+  }
+  m_process.kill();
+  m_process.waitForFinished(shutdownWait);
+}
+
+void LanguageClient::setFileName(const QString &fileName) {
+  const QString fileUri = uri(fileName);
+  if (fileUri == m_uri)
+    return;
+  close();
+  m_uri = fileUri;
+  if (m_ready)
+    open();
+}
+
+void LanguageClient::send(QJsonObject message) {
+  message.insert("jsonrpc", "2.0");
+  const QByteArray body =
+      QJsonDocument(message).toJson(QJsonDocument::Compact);
+  m_process.write("Content-Length: " + QByteArray::number(body.size()) +
+                  "\r\n\r\n" + body);
+}
+
+int LanguageClient::request(const QString &method, const QJsonObject &params,
+                            Handler handler, bool anyVersion) {
+  const int id = m_nextId++;
+  m_pending.insert(id, {anyVersion ? -1 : m_version, std::move(handler)});
+  send({{"id", id}, {"method", method}, {"params", params}});
+  return id;
+}
+
+void LanguageClient::notify(const QString &method, const QJsonObject &params) {
+  send({{"method", method}, {"params", params}});
+}
+
+void LanguageClient::reply(const QJsonValue &id, const QJsonValue &result) {
+  send({{"id", id}, {"result", result}});
+}
+
+void LanguageClient::readMessages() {
+  m_received += m_process.readAllStandardOutput();
+  for (;;) {
+    const int headerEnd = m_received.indexOf("\r\n\r\n");
+    if (headerEnd < 0)
+      return;
+    int length = -1;
+    for (const QByteArray &line : m_received.left(headerEnd).split('\n'))
+      if (line.toLower().startsWith("content-length:"))
+        length = line.mid(15).trimmed().toInt();
+    const int bodyStart = headerEnd + 4;
+    if (length < 0) { // not a header, skipped
+      m_received.remove(0, bodyStart);
+      continue;
+    }
+    if (m_received.size() < bodyStart + length)
+      return;
+    const QJsonDocument message =
+        QJsonDocument::fromJson(m_received.mid(bodyStart, length));
+    m_received.remove(0, bodyStart + length);
+    if (message.isObject())
+      dispatch(message.object());
+  }
+}
+
+void LanguageClient::dispatch(const QJsonObject &message) {
+  const QString method = message.value("method").toString();
+  if (method.isEmpty()) { // the answer to a request
+    auto it = m_pending.find(message.value("id").toInt());
+    if (it == m_pending.end())
+      return;
+    const Pending pending = it.value();
+    m_pending.erase(it);
+    if (message.contains("error"))
+      qDebug() << "Language server:"
+               << message.value("error").toObject().value("message");
+    else if (pending.version < 0 || pending.version == m_version)
+      pending.handler(message.value("result"));
+    return;
+  }
+  if (method == "textDocument/publishDiagnostics")
+    publishDiagnostics(message.value("params").toObject());
+  else if (message.contains("id")) // a request of the server, none is needed
+    reply(message.value("id"), QJsonValue::Null);
+}
+
+void LanguageClient::initialized(const QJsonObject &capabilities) {
+  // either a TextDocumentSyncKind or TextDocumentSyncOptions
+  const QJsonValue sync = capabilities.value("textDocumentSync");
+  const int change =
+      sync.isObject() ? sync.toObject().value("change").toInt() : sync.toInt();
+  m_incremental = change == 2;
+
+  const QJsonObject tokens =
+      capabilities.value("semanticTokensProvider").toObject();
+  m_rangeTokens = !tokens.value("range").isUndefined() &&
+                  tokens.value("range") != QJsonValue(false);
+  m_tokenTypes.clear();
+  for (const auto &type :
+       tokens.value("legend").toObject().value("tokenTypes").toArray())
+    m_tokenTypes << type.toString();
+
+  notify("initialized", {});
+  m_ready = true;
+  open();
+  emit ready();
+}
+
+void LanguageClient::open() {
+  m_shadow = m_document->toPlainText();
+  m_changes = QJsonArray();
+  notify("textDocument/didOpen",
+         {{"textDocument", QJsonObject{{"uri", m_uri},
+                                       {"languageId", "c"},
+                                       {"version", m_version},
+                                       {"text", m_shadow}}}});
+  m_opened = true;
+}
+
+void LanguageClient::close() {
+  if (!m_opened)
+    return;
+  m_flushTimer.stop();
+  m_changes = QJsonArray();
+  notify("textDocument/didClose", {{"textDocument", textDocument()}});
+  m_opened = false;
+}
+
+QJsonObject LanguageClient::textDocument() const {
+  return {{"uri", m_uri}, {"version", m_version}};
+}
+
+// where offset of the document is, in utf-16 units as QString counts them
+QJsonObject LanguageClient::position(int offset) const {
+  const QTextBlock block = m_document->findBlock(offset);
+  return {{"line", block.blockNumber()},
+          {"character", offset - block.position()}};
+}
+
+void LanguageClient::contentsChanged(int position, int removed, int added) {
+  if (!m_opened)
+    return;
+  // a change of the whole document counts its implicit last paragraph
+  // separator, which is not part of the text
+  removed = std::min(removed, m_shadow.size() - position);
+  added = std::min(added, m_document->characterCount() - 1 - position);
+  if (position < 0 || removed < 0 || added < 0)
+    return;
+  QTextCursor cursor(m_document);
+  cursor.setPosition(position);
+  cursor.setPosition(position + added, QTextCursor::KeepAnchor);
+  QString text = cursor.selectedText();
+  text.replace(QChar::ParagraphSeparator, '\n');
+  const QStringRef old = m_shadow.midRef(position, removed);
+  if (old == text)
+    return; // only formats changed
+
+  // the text before position is the same in both, so its line and column
+  // are found in the document; the end of the removed text is only in the
+  // shadow
+  const QJsonObject start = this->position(position);
+  const int removedLines = old.count('\n');
+  const int endColumn =
+      removedLines ? removed - old.lastIndexOf('\n') - 1
+                   : start.value("character").toInt() + removed;
+  m_changes.append(QJsonObject{
+      {"range",
+       QJsonObject{{"start", start},
+                   {"end", QJsonObject{{"line", start.value("line").toInt() +
+                                                    removedLines},
+                                       {"character", endColumn}}}}},
+      {"text", text}});
+  m_shadow.replace(position, removed, text);
+  ++m_version;
+  m_flushTimer.start();
+}
+
+void LanguageClient::flushChanges() {
+  m_flushTimer.stop();
+  if (!m_opened || m_changes.isEmpty())
+    return;
+  const QJsonArray changes =
+      m_incremental ? m_changes : QJsonArray{QJsonObject{{"text", m_shadow}}};
+  notify("textDocument/didChange",
+         {{"textDocument", textDocument()}, {"contentChanges", changes}});
+  m_changes = QJsonArray();
+}
+
+void LanguageClient::requestCompletion(int position, const QString &prefix) {
+  if (!m_opened)
+    return;
+  flushChanges();
+  request("textDocument/completion",
+          {{"textDocument", textDocument()},
+           {"position", this->position(position)}},
+          [this, prefix](const QJsonValue &result) {
+            // a CompletionList or just its items
+            const QJsonArray items = result.isObject()
+                                         ? result.toObject()
+                                               .value("items")
+                                               .toArray()
+                                         : result.toArray();
+            QStringList completions;
+            for (const auto &value : items) {
+              const QJsonObject item = value.toObject();
+              const QJsonObject edit = item.value("textEdit").toObject();
+              QString text = edit.value("newText").toString();
+              if (text.isEmpty())
+                text = item.value("insertText").toString();
+              if (text.isEmpty())
+                text = item.value("label").toString().trimmed();
+              if (!text.isEmpty() && !completions.contains(text))
+                completions << text;
+            }
+            emit completionsReady(prefix, completions);
+          });
+}
+
+void LanguageClient::requestHover(int position) {
+  if (!m_opened)
+    return;
+  flushChanges();
+  request("textDocument/hover",
+          {{"textDocument", textDocument()},
+           {"position", this->position(position)}},
+          [this, position](const QJsonValue &result) {
+            const QString text =
+                hoverText(result.toObject().value("contents")).trimmed();
+            if (!text.isEmpty())
+              emit hoverReady(position, text);
+          });
+}
+
+void LanguageClient::requestSemanticTokens(int firstLine, int lastLine) {
+  if (!m_opened || !m_rangeTokens)
+    return;
+  flushChanges();
+  const QJsonObject range{
+      {"start", QJsonObject{{"line", firstLine}, {"character", 0}}},
+      {"end", QJsonObject{{"line", lastLine + 1}, {"character", 0}}}};
+  request("textDocument/semanticTokens/range",
+          {{"textDocument", textDocument()}, {"range", range}},
+          [this](const QJsonValue &result) {
+            // five numbers a token, each placed relative to the one before
+            const QJsonArray data = result.toObject().value("data").toArray();
+            QVector<SemanticToken> tokens;
+            tokens.reserve(data.size() / 5);
+            int line = 0, column = 0;
+            for (int i = 0; i + 4 < data.size(); i += 5) {
+              const int deltaLine = data[i].toInt();
+              line += deltaLine;
+              column = deltaLine ? data[i + 1].toInt()
+                                 : column + data[i + 1].toInt();
+              tokens.push_back({line, column, data[i + 2].toInt(),
+                                m_tokenTypes.value(data[i + 3].toInt())});
+            }
+            emit semanticTokensReady(tokens);
+          });
+}
+
+void LanguageClient::publishDiagnostics(const QJsonObject &params) {
+  if (params.value("uri").toString() != m_uri)
+    return;
+  const QJsonValue version = params.value("version");
+  if (!version.isUndefined() && !version.isNull() &&
+      version.toInt() != m_version)
+    return; // of an older text
+  QVector<Diagnostic> diagnostics;
+  for (const auto &value : params.value("diagnostics").toArray()) {
+    const QJsonObject diagnostic = value.toObject();
+    const QJsonObject start =
+        diagnostic.value("range").toObject().value("start").toObject();
+    diagnostics.push_back({start.value("line").toInt() + 1,
+                           start.value("character").toInt() + 1,
+                           diagnostic.value("message").toString(),
+                           diagnostic.value("severity").toInt(1) == 1});
+  }
+  emit diagnosticsReady(diagnostics);
+}
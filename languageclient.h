@@ -0,0 +1,104 @@
+#ifndef LANGUAGECLIENT_H
+#define LANGUAGECLIENT_H
+
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QObject>
+#include <QProcess>
+#include <QStringList>
+#include <QTimer>
+#include <QVector>
+#include <functional>
+
+class QTextDocument;
+
+// talks the language server protocol to a clangd on stdio about one
+// document: edits are sent as they happen, as incremental changes where the
+// server takes them, and completions, hovers, diagnostics and semantic tokens
+// come back as signals; answers about an older text than the document's are
+// dropped
+class LanguageClient : public QObject {
+  Q_OBJECT
+public:
+  struct Diagnostic {
+    int line, column; // 1 based
+    QString message;
+    bool error;
+  };
+  struct SemanticToken {
+    int line, column, length; // 0 based
+    QString type;             // as the server's legend names it
+  };
+
+  explicit LanguageClient(QTextDocument *document, QObject *parent = nullptr);
+  ~LanguageClient() override;
+
+  // clangd on the path, empty without one
+  static QString findServer();
+
+  // starts the server on fileName, the document is opened once it is up
+  void start(const QString &program, const QString &fileName);
+  void stop();
+  bool isReady() const { return m_ready; }
+  // the document was saved as or loaded from fileName
+  void setFileName(const QString &fileName);
+
+  // bumped by every change of the document
+  int version() const { return m_version; }
+
+  // the answers come as the signals below, unless the document changed
+  void requestCompletion(int position, const QString &prefix);
+  void requestHover(int position);
+  // of the lines from firstLine to lastLine, 0 based
+  void requestSemanticTokens(int firstLine, int lastLine);
+
+signals:
+  void ready();
+  // the server exited or could not be started
+  void stopped(const QString &reason);
+  void completionsReady(const QString &prefix, const QStringList &completions);
+  void hoverReady(int position, const QString &text);
+  void diagnosticsReady(const QVector<LanguageClient::Diagnostic> &diagnostics);
+  void semanticTokensReady(
+      const QVector<LanguageClient::SemanticToken> &tokens);
+
+private:
+  using Handler = std::function<void(const QJsonValue &result)>;
+  struct Pending {
+    int version; // of the document when asked, -1 when it does not matter
+    Handler handler;
+  };
+
+  QTextDocument *m_document;
+  QProcess m_process;
+  QByteArray m_received; // a message cut by the end of a read
+  QHash<int, Pending> m_pending;
+  int m_nextId = 1, m_version = 0;
+  bool m_ready = false, m_opened = false, m_stopping = false;
+  bool m_incremental = true, m_rangeTokens = false;
+  QString m_uri;
+  QStringList m_tokenTypes; // legend of the server's semantic tokens
+  // the text as the server has it, changes are found against it
+  QString m_shadow;
+  QJsonArray m_changes; // not sent yet
+  QTimer m_flushTimer;
+
+  void send(QJsonObject message);
+  int request(const QString &method, const QJsonObject &params,
+              Handler handler, bool anyVersion = false);
+  void notify(const QString &method, const QJsonObject &params);
+  void reply(const QJsonValue &id, const QJsonValue &result);
+  void readMessages();
+  void dispatch(const QJsonObject &message);
+  void initialized(const QJsonObject &capabilities);
+  void open();
+  void close();
+  void contentsChanged(int position, int removed, int added);
+  void flushChanges();
+  void publishDiagnostics(const QJsonObject &params);
+  QJsonObject position(int offset) const;
+  QJsonObject textDocument() const;
+};
+
+#endif // LANGUAGECLIENT_H
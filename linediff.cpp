@@ -0,0 +1,138 @@
+#include "linediff.h"
+#include <QHash>
+#include <vector>
+
+namespace {
+// bounds the trace, which grows with the square of the edits: past it the
+// differing middle is reported as a single hunk
+const std::size_t maxTraceSize = std::size_t(1) << 21; // ints, 8 MiB
+
+// Myers' algorithm on n old against m new lines, equal(x, y) compares them;
+// the hunks are relative to the first lines given
+template <typename Equal>
+QVector<LineDiff::Hunk> myers(int n, int m, Equal equal, int maxEdits) {
+  using Hunk = LineDiff::Hunk;
+  const Hunk whole{0, n, 0, m};
+  if (n == 0 || m == 0)
+    return {whole};
+
+  // v[k] is the furthest x reached on diagonal k = x - y; trace keeps the
+  // 2d + 1 diagonals of every round for walking the path back, those of
+  // round d start at d * d
+  const int limit = std::min(n + m, maxEdits), offset = limit + 1;
+  std::vector<int> v(2 * offset + 1, 0);
+  std::vector<int> trace;
+  int d = 0;
+  for (bool done = false; !done; ++d) {
+    if (d > limit || trace.size() + 2 * d + 1 > maxTraceSize)
+      return {whole};
+    trace.insert(trace.end(), v.begin() + offset - d,
+                 v.begin() + offset + d + 1);
+    for (int k = -d; k <= d && !done; k += 2) {
+      int x = k == -d || (k != d && v[offset + k - 1] < v[offset + k + 1])
+                  ? v[offset + k + 1]
+                  : v[offset + k - 1] + 1;
+      int y = x - k;
+      while (x < n && y < m && equal(x, y))
+        ++x, ++y;
+      v[offset + k] = x;
+      done = x >= n && y >= m;
+    }
+  }
+
+  std::vector<bool> removed(n, false), inserted(m, false);
+  int x = n, y = m;
+  for (--d; d > 0; --d) {
+    const int *previous = trace.data() + d * d; // diagonals -d .. d
+    auto at = [&](int k) { return previous[k + d]; };
+    const int k = x - y;
+    const int previousK =
+        k == -d || (k != d && at(k - 1) < at(k + 1)) ? k + 1 : k - 1;
+    const int previousX = at(previousK), previousY = previousX - previousK;
+    while (x > previousX && y > previousY)
+      --x, --y;
+    if (x == previousX)
+      inserted[--y] = true;
+    else
+      removed[--x] = true;
+  }
+
+  QVector<Hunk> hunks;
+  for (int i = 0, j = 0; i < n || j < m;) {
+    if (i < n && j < m && !removed[i] && !inserted[j]) {
+      ++i, ++j;
+      continue;
+    }
+    Hunk hunk{i, 0, j, 0};
+    for (; i < n && removed[i]; ++i)
+      ++hunk.oldCount;
+    for (; j < m && inserted[j]; ++j)
+      ++hunk.newCount;
+    hunks.push_back(hunk);
+  }
+  return hunks;
+}
+} // namespace
+
+QVector<LineDiff::Hunk> LineDiff::compute(const QStringList &oldLines,
+                                          const QStringList &newLines,
+                                          int maxEdits) {
+  // the common head and tail are by far the largest part of a reload
+  int prefix = 0, suffix = 0;
+  const int oldSize = oldLines.size(), newSize = newLines.size();
+  while (prefix < oldSize && prefix < newSize &&
+         oldLines[prefix] == newLines[prefix])
+    ++prefix;
+  while (suffix < oldSize - prefix && suffix < newSize - prefix &&
+         oldLines[oldSize - 1 - suffix] == newLines[newSize - 1 - suffix])
+    ++suffix;
+
+  const int n = oldSize - prefix - suffix, m = newSize - prefix - suffix;
+  if (n == 0 && m == 0)
+    return {};
+  const Hunk whole{prefix, n, prefix, m};
+  if (n == 0 || m == 0)
+    return {whole};
+
+  std::vector<uint> a(n), b(m);
+  for (int i = 0; i < n; ++i)
+    a[i] = qHash(oldLines[prefix + i]);
+  for (int j = 0; j < m; ++j)
+    b[j] = qHash(newLines[prefix + j]);
+  auto hunks = myers(
+      n, m,
+      [&](int x, int y) {
+        return a[x] == b[y] && oldLines[prefix + x] == newLines[prefix + y];
+      },
+      maxEdits);
+  for (auto &hunk : hunks)
+    hunk.oldStart += prefix, hunk.newStart += prefix;
+  return hunks;
+}
+
+quint64 LineDiff::hash(const QString &line) {
+  return quint64(qHash(line)) << 32 | qHash(line, 0x9e3779b9);
+}
+
+QVector<LineDiff::Hunk> LineDiff::compute(const quint64 *oldHashes,
+                                          int oldSize,
+                                          const quint64 *newHashes,
+                                          int newSize, int maxEdits) {
+  int prefix = 0, suffix = 0;
+  while (prefix < oldSize && prefix < newSize &&
+         oldHashes[prefix] == newHashes[prefix])
+    ++prefix;
+  while (suffix < oldSize - prefix && suffix < newSize - prefix &&
+         oldHashes[oldSize - 1 - suffix] == newHashes[newSize - 1 - suffix])
+    ++suffix;
+
+  const int n = oldSize - prefix - suffix, m = newSize - prefix - suffix;
+  if (n == 0 && m == 0)
+    return {};
+  const quint64 *a = oldHashes + prefix, *b = newHashes + prefix;
+  auto hunks = myers(
+      n, m, [a, b](int x, int y) { return a[x] == b[y]; }, maxEdits);
+  for (auto &hunk : hunks)
+    hunk.oldStart += prefix, hunk.newStart += prefix;
+  return hunks;
+}
@@ -0,0 +1,32 @@
+#ifndef LINEDIFF_H
+#define LINEDIFF_H
+
+#include <QStringList>
+#include <QVector>
+
+// line based differences between two texts
+class LineDiff {
+public:
+  // lines [oldStart, oldStart + oldCount) of the old text are replaced by
+  // lines [newStart, newStart + newCount) of the new one
+  struct Hunk {
+    int oldStart, oldCount, newStart, newCount;
+  };
+
+  // the shortest list of hunks turning oldLines into newLines, found with
+  // Myers' algorithm over hashed lines; past maxEdits changed lines, or
+  // about 1400 for the memory it takes, the differing middle is reported as
+  // a single hunk
+  static QVector<Hunk> compute(const QStringList &oldLines,
+                               const QStringList &newLines,
+                               int maxEdits = 4000);
+
+  // 64 bits of hash of a line, equal hashes are taken as equal lines
+  static quint64 hash(const QString &line);
+  // the same on lines given by their hashes
+  static QVector<Hunk> compute(const quint64 *oldHashes, int oldSize,
+                               const quint64 *newHashes, int newSize,
+                               int maxEdits = 4000);
+};
+
+#endif // LINEDIFF_H
@@ -0,0 +1,58 @@
+#include "lineprofile.h"
+#include <QCryptographicHash>
+#include <algorithm>
+#include <cmath>
+
+LineProfile LineProfile::fromGcov(const QByteArray &gcov) {
+  LineProfile profile;
+  // "<count>:<line>:<source>", the count "-" for lines without code and
+  // "#####" or "=====" for lines that never ran; a '*' marks a line with a
+  // block that never ran
+  int lastLine = 0;
+  for (const QByteArray &row : gcov.split('\n')) {
+    const int countEnd = row.indexOf(':');
+    const int lineEnd = row.indexOf(':', countEnd + 1);
+    if (countEnd < 0 || lineEnd < 0)
+      continue;
+    bool isLine;
+    const int line = row.mid(countEnd + 1, lineEnd - countEnd - 1)
+                         .trimmed()
+                         .toInt(&isLine);
+    if (!isLine || line <= lastLine)
+      continue; // the header, a summary or a repeated line, see below
+    // the main listing counts every copy of a line, after it come listings
+    // of its template instances and functions sharing it which repeat lines
+    // with their own share of the count
+    lastLine = line;
+    QByteArray field = row.left(countEnd).trimmed();
+    if (field.endsWith('*'))
+      field.chop(1);
+    qint64 count = -1;
+    if (field.startsWith('#') || field.startsWith('='))
+      count = 0;
+    else if (field != "-")
+      count = field.toLongLong();
+
+    const int known = profile.m_counts.size(); // up to the previous line
+    profile.m_counts.resize(line);
+    std::fill(profile.m_counts.begin() + known, profile.m_counts.end(), -1);
+    profile.m_counts.last() = count;
+    profile.m_max = std::max(profile.m_max, count);
+  }
+  return profile;
+}
+
+QByteArray LineProfile::buildHash(const QString &program,
+                                  const QString &source) {
+  QCryptographicHash hash(QCryptographicHash::Md5);
+  hash.addData(program.toUtf8() + '\0');
+  hash.addData(source.toUtf8());
+  return hash.result();
+}
+
+double LineProfile::heat(int line) const {
+  const qint64 runs = count(line);
+  if (runs <= 0 || m_max <= 0)
+    return 0;
+  return std::log1p(double(runs)) / std::log1p(double(m_max));
+}
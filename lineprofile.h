@@ -0,0 +1,32 @@
+#ifndef LINEPROFILE_H
+#define LINEPROFILE_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+// how many times each line of a source ran, from the .gcov file gcov writes
+// for a --coverage build
+class LineProfile {
+public:
+  // the counts of the lines in gcov, empty if it holds none
+  static LineProfile fromGcov(const QByteArray &gcov);
+  // identifies the build of source by program, profiles are kept by it
+  static QByteArray buildHash(const QString &program, const QString &source);
+
+  bool isEmpty() const { return m_counts.isEmpty(); }
+  // runs of line, 1 based, -1 if no code was generated for it
+  qint64 count(int line) const {
+    return line > 0 && line <= m_counts.size() ? m_counts[line - 1] : -1;
+  }
+  qint64 maxCount() const { return m_max; }
+  // 0 for a line that never ran up to 1 for the hottest, on a log scale as
+  // the counts of nested loops are orders of magnitude apart
+  double heat(int line) const;
+
+private:
+  QVector<qint64> m_counts;
+  qint64 m_max = 0;
+};
+
+#endif // LINEPROFILE_H
@@ -1,47 +1,460 @@
 #include "mainwindow.h"
+#include "bufferdiff.h"
+#include "compiletimegraph.h"
+#include "completionengine.h"
 #include "cppsyntaxhightlighter.h"
+#include "diffpanel.h"
+#include "editjournal.h"
 #include "editprocess.h"
+#include "findbar.h"
+#include "findinfilespanel.h"
+#include "keystrokesession.h"
+#include "languageclient.h"
+#include "lineprofile.h"
+#include "memorypanel.h"
+#include "memoryregistry.h"
+#include "minimap.h"
 #include "sourcecodeeditor.h"
+#include "speculativebuild.h"
+#include "stallwatchdog.h"
+#include "stresspanel.h"
+#include "symbolindex.h"
+#include "testpanel.h"
+#include "textencoding.h"
+#include "textsearch.h"
+#include "toolchain.h"
+#include "undohistory.h"
 #include "ui_mainwindow.h"
 #include <QAction>
+#include <QActionGroup>
 #include <QCompleter>
+#include <QDateTime>
 #include <QDebug>
+#include <QDir>
 #include <QFile>
 #include <QFileDialog>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QHBoxLayout>
+#include <QHash>
+#include <QLabel>
+#include <QLocale>
+#include <QMessageBox>
+#include <QPlainTextEdit>
+#include <QPointer>
 #include <QSplitter>
+#include <QStatusBar>
 #include <QTabWidget>
+#include <QTemporaryDir>
+#include <QTemporaryFile>
+#include <QTextCursor>
 #include <QVBoxLayout>
+#include <QtConcurrent>
 #include <cstdlib>
 
 struct MainWindow::_Detail {
   SourceCodeEditor sourceEdit;
   QVBoxLayout centralWidgetVLayout;
-  EditProcess compilationEdit, runEdit;
+  // the consoles, the completer and the compiler are set up on first use,
+  // keeping them off the startup path
+  std::unique_ptr<EditProcess> compilationProcess, runProcess;
   QTabWidget runMenuTabs;
+  // after runMenuTabs, so it leaves its tab before the tabs are destroyed
+  std::unique_ptr<FindInFilesPanel> findInFilesPanel;
+  std::unique_ptr<MemoryPanel> memoryPanel;
+  std::unique_ptr<TestPanel> testPanel;
+  std::unique_ptr<StressPanel> stressPanel;
+  std::unique_ptr<DiffPanel> diffPanel;
+  // the compilation console above its timing report
+  std::unique_ptr<QWidget> compilationPane;
+  QWidget *compileTimeReport = nullptr;
+  QLabel *compileTimeSummary = nullptr;
+  CompileTimeGraph *compileTimeGraph = nullptr;
+  CompileTimeHistory compileTimeHistory;
   CppSyntaxHightlighter highlighter;
-  QCompleter completer;
-  _Detail() : highlighter{sourceEdit.document()} {
-    completer.setModel(highlighter.wordsListModel());
-    sourceEdit.setCompleter(&completer);
+  UndoHistory undoHistory;
+  TextSearch textSearch;
+  FindBar findBar;
+  Minimap minimap;
+  EditJournal journal;
+  SpeculativeBuild speculativeBuild;
+  BufferDiff bufferDiff;
+  KeystrokeRecorder keystrokeRecorder;
+  StallWatchdog stallWatchdog;
+  DiffPanel::Base diffBase = DiffPanel::SavedFile;
+  QString lastBuiltSource; // null until a build succeeds
+  std::unique_ptr<CompletionEngine> completionEngine;
+  std::unique_ptr<QCompleter> completer;
+  std::unique_ptr<LanguageClient> languageClient;
+  QFutureWatcher<bool> symbolIndexBuild;
+  QFutureWatcher<void> toolchainDetection;
+  Toolchain selectedToolchain;
+  std::unique_ptr<QTemporaryFile> quickRunSource;
+  // the coverage build being run and the profiles read so far, by build hash
+  std::unique_ptr<QTemporaryDir> lineProfileDir;
+  QByteArray lineProfileBuild;
+  QStringList lineProfileTool;
+  QMetaObject::Connection lineProfileRun;
+  QHash<QByteArray, std::shared_ptr<const LineProfile>> lineProfiles;
+  bool runInTerminal = false;
+  bool timeCompilation = false;
+  _Detail()
+      : highlighter{sourceEdit.document()}, undoHistory{sourceEdit.document()},
+        textSearch{sourceEdit.document()}, findBar{&sourceEdit, &textSearch},
+        minimap{&sourceEdit, &highlighter},
+        journal{sourceEdit.document()},
+        speculativeBuild{sourceEdit.document()},
+        bufferDiff{sourceEdit.document()}, keystrokeRecorder{&sourceEdit} {
+    sourceEdit.setHighlighter(&highlighter);
+    sourceEdit.setUndoHistory(&undoHistory);
+    sourceEdit.setTextSearch(&textSearch);
+    sourceEdit.setBufferDiff(&bufferDiff);
+    QObject::connect(&sourceEdit, &SourceCodeEditor::fileSynced,
+                     [this](const QString &fileName) {
+                       journal.checkpoint(fileName);
+                       if (languageClient)
+                         languageClient->setFileName(fileName);
+                       if (diffBase == DiffPanel::SavedFile)
+                         bufferDiff.setBase(
+                             sourceEdit.document()->toPlainText());
+                     });
+    registerMemorySources();
+  }
 
-    compilationEdit.setArguments({"-x", "c", "-Wall", "-"});
-    qputenv("path", qgetenv("path") + ";./Mingw/bin/");
-    if (QFile("./Mingw/bin/gcc.exe").exists())
-      compilationEdit.setProgram("./Mingw/bin/gcc.exe");
-    else
-      compilationEdit.setProgram("gcc");
-    qDebug() << "Compiler exe " << compilationEdit.program();
+  // the run console outlives the members a profiled run reports to, and
+  // finishes its program when it is destroyed
+  ~_Detail() { QObject::disconnect(lineProfileRun); }
+
+  void registerMemorySources() {
+    auto &registry = MemoryRegistry::instance();
+    auto document = sourceEdit.document();
+    registry.add(&sourceEdit, "Document text",
+                 [document]() { return MemoryRegistry::textBytes(document); });
+    registry.add(
+        &sourceEdit, "Document layout",
+        [document]() { return MemoryRegistry::layoutBytes(document); },
+        [this]() { MemoryRegistry::releaseLayouts(&sourceEdit); });
+    registry.add(
+        &highlighter, "Highlighter words and tokens",
+        [this]() { return highlighter.memoryUsage(); },
+        [this]() { highlighter.squeeze(); });
+    registry.add(
+        &sourceEdit, "Compiler messages",
+        [this]() { return sourceEdit.compilerMsgsMemoryUsage(); },
+        [this]() { sourceEdit.squeezeCompilerMsgs(); });
+    registry.add(&undoHistory, "Undo history",
+                 [this]() { return undoHistory.memoryUsage(); });
+  }
+
+  static void registerConsole(EditProcess &process, const QString &name) {
+    QPointer<QPlainTextEdit> edit = process.edit();
+    MemoryRegistry::instance().add(
+        &process, name,
+        [edit]() {
+          return edit ? MemoryRegistry::textBytes(edit->document()) +
+                            MemoryRegistry::layoutBytes(edit->document())
+                      : 0;
+        },
+        [edit]() {
+          if (edit)
+            MemoryRegistry::releaseLayouts(edit);
+        });
+  }
+
+  EditProcess &compilationEdit() {
+    if (!compilationProcess) {
+      compilationProcess = std::make_unique<EditProcess>();
+      compilationPane = std::make_unique<QWidget>();
+      compileTimeReport = new QWidget;
+      compileTimeSummary = new QLabel;
+      compileTimeSummary->setTextInteractionFlags(Qt::TextSelectableByMouse);
+      compileTimeGraph = new CompileTimeGraph;
+      auto reportLayout = new QHBoxLayout(compileTimeReport);
+      reportLayout->setContentsMargins(0, 0, 0, 0);
+      reportLayout->addWidget(compileTimeSummary);
+      reportLayout->addWidget(compileTimeGraph, 1);
+      compileTimeReport->hide();
+      auto paneLayout = new QVBoxLayout(compilationPane.get());
+      paneLayout->setContentsMargins(0, 0, 0, 0);
+      paneLayout->addWidget(compilationProcess->edit());
+      paneLayout->addWidget(compileTimeReport);
+      runMenuTabs.insertTab(0, compilationPane.get(), "Compilation");
+      registerConsole(*compilationProcess, "Compilation console");
+    }
+    return *compilationProcess;
+  }
+
+  EditProcess &runEdit() {
+    if (!runProcess) {
+      runProcess = std::make_unique<EditProcess>();
+      runMenuTabs.addTab(runProcess->edit(), "Run");
+      registerConsole(*runProcess, "Run console");
+    }
+    return *runProcess;
+  }
+
+  // whether the unsaved changes may be dropped for opening fileName
+  bool confirmDiscard(const QString &fileName) {
+    return !sourceEdit.document()->isModified() ||
+           QMessageBox::question(
+               &sourceEdit, QObject::tr("Unsaved Changes"),
+               QObject::tr("Open %1 and discard your unsaved changes?")
+                   .arg(QFileInfo(fileName).fileName()),
+               QMessageBox::Yes | QMessageBox::No,
+               QMessageBox::No) == QMessageBox::Yes;
+  }
+
+  FindInFilesPanel &findInFiles() {
+    if (!findInFilesPanel) {
+      findInFilesPanel = std::make_unique<FindInFilesPanel>();
+      QObject::connect(findInFilesPanel.get(),
+                       &FindInFilesPanel::openRequested,
+                       [this](const QString &fileName, int line, int column) {
+                         if (fileName != sourceEdit.fileName() &&
+                             (!confirmDiscard(fileName) ||
+                              sourceEdit.loadFile(fileName)))
+                           return;
+                         sourceEdit.goToLine(line, column);
+                       });
+      runMenuTabs.addTab(findInFilesPanel.get(), "Find in Files");
+    }
+    return *findInFilesPanel;
+  }
+
+  TestPanel &tests() {
+    if (!testPanel) {
+      testPanel = std::make_unique<TestPanel>();
+      QObject::connect(testPanel.get(), &TestPanel::runRequested,
+                       [this]() { runTests(); });
+      runMenuTabs.addTab(testPanel.get(), "Tests");
+    }
+    return *testPanel;
+  }
+
+  StressPanel &stress() {
+    if (!stressPanel) {
+      stressPanel = std::make_unique<StressPanel>();
+      QObject::connect(stressPanel.get(), &StressPanel::startRequested,
+                       [this](const QString &generator,
+                              const QString &reference) {
+                         startStressTest(generator, reference);
+                       });
+      runMenuTabs.addTab(stressPanel.get(), "Stress");
+    }
+    return *stressPanel;
+  }
+
+  // the edited program is the solution, all three are built with the current
+  // toolchain before any seed runs
+  void startStressTest(const QString &generator, const QString &reference) {
+    compileSrcEdit();
+    if (compilationEdit().exitCode() || !compileFile(generator, "stress-gen") ||
+        !compileFile(reference, "stress-ref"))
+      return;
+    runMenuTabs.setCurrentWidget(&stress());
+    stress().start("./stress-gen", "./a", "./stress-ref");
+  }
+
+  DiffPanel &diff() {
+    if (!diffPanel) {
+      diffPanel =
+          std::make_unique<DiffPanel>(&bufferDiff, sourceEdit.document());
+      QObject::connect(diffPanel.get(), &DiffPanel::baseChanged,
+                       [this](DiffPanel::Base base) { setDiffBase(base); });
+      QObject::connect(diffPanel.get(), &DiffPanel::lineRequested,
+                       [this](int line) { sourceEdit.goToLine(line); });
+      runMenuTabs.addTab(diffPanel.get(), "Changes");
+    }
+    return *diffPanel;
+  }
+
+  void setDiffBase(DiffPanel::Base base) {
+    diffBase = base;
+    if (base == DiffPanel::LastBuild) {
+      if (lastBuiltSource.isNull())
+        bufferDiff.clearBase();
+      else
+        bufferDiff.setBase(lastBuiltSource);
+      return;
+    }
+    QFile file(sourceEdit.fileName());
+    if (sourceEdit.fileName().isEmpty() || !file.open(QFile::ReadOnly)) {
+      bufferDiff.clearBase();
+      return;
+    }
+    TextEncoding encoding;
+    bufferDiff.setBase(TextEncoding::decode(file.readAll(), &encoding));
+  }
+
+  void builtSource(const QString &source) {
+    lastBuiltSource = source;
+    if (diffBase == DiffPanel::LastBuild)
+      bufferDiff.setBase(source);
+  }
+
+  // clangd for completions, hovers, diagnostics and semantic colours, false
+  // when there is none
+  bool setLanguageServer(bool enabled) {
+    sourceEdit.setLanguageClient(nullptr);
+    languageClient.reset();
+    if (!enabled)
+      return true;
+    const QString server = LanguageClient::findServer();
+    if (server.isEmpty())
+      return false;
+    languageClient = std::make_unique<LanguageClient>(sourceEdit.document());
+    languageClient->start(server, sourceEdit.fileName().isEmpty()
+                                      ? QDir::current().filePath("untitled.c")
+                                      : sourceEdit.fileName());
+    sourceEdit.setLanguageClient(languageClient.get());
+    return true;
+  }
+
+  MemoryPanel &memory() {
+    if (!memoryPanel) {
+      memoryPanel = std::make_unique<MemoryPanel>();
+      runMenuTabs.addTab(memoryPanel.get(), "Memory");
+    }
+    return *memoryPanel;
+  }
+
+  // waits for the detection if it is still running
+  const Toolchain &toolchain() {
+    if (selectedToolchain.isNull()) {
+      const auto &available = Toolchain::available();
+      selectToolchain(available.isEmpty() ? Toolchain(Toolchain::Gcc, "gcc")
+                                          : available.first());
+      qDebug() << "Compiler exe " << selectedToolchain.program();
+    }
+    return selectedToolchain;
+  }
+
+  void selectToolchain(const Toolchain &toolchain) {
+    selectedToolchain = toolchain;
+    speculativeBuild.setCompiler(
+        toolchain.program(), [toolchain](const QString &output) {
+          return toolchain.compileArguments(output);
+        });
+  }
+
+  // puts the build made while typing paused in place of a compilation, if it
+  // is of the current text
+  bool takeSpeculativeBuild() {
+    QString output;
+    if (timeCompilation || !speculativeBuild.take("a", &output))
+      return false;
+    compilationEdit().edit()->setPlainText(output);
+    compileTimeReport->hide();
+    builtSource(sourceEdit.document()->toPlainText());
+    sourceEdit.setCompilerMsgs(
+        std::bind(&_Detail::parseCompilerOutput, this, std::placeholders::_1));
+    return true;
+  }
+
+  const QString &compiler() { return toolchain().program(); }
+
+  // everything that is not needed for the first frame
+  void finishStartup() {
+    completionEngine = std::make_unique<CompletionEngine>(&highlighter);
+    completer = std::make_unique<QCompleter>();
+    completer->setModel(completionEngine->model());
+    sourceEdit.setCompleter(completer.get());
+    sourceEdit.setCompletionEngine(completionEngine.get());
+    detectToolchains();
+    recoverJournal();
+    // after startup, whose slow parts StartupProfile already reports
+    stallWatchdog.start();
   }
 
   void compileSrcEdit();
+  bool compileFile(const QString &source, const QString &output);
+  void reportCompileTimes(const QString &traceDir);
+  void runProgram(const QString &program, const QStringList &arguments);
+  void collectLineProfile();
 
 public:
   void run();
+  void quickRun();
+  // builds the source and runs the test cases against it
+  void runTests();
+  void runWithLineProfile();
+
+  // the profile of a run of the current text, false if there is none
+  bool showLineProfile(bool shown) {
+    if (!shown) {
+      sourceEdit.setLineProfile(nullptr);
+      return true;
+    }
+    auto profile = lineProfiles.value(LineProfile::buildHash(
+        toolchain().program(), sourceEdit.document()->toPlainText()));
+    if (!profile)
+      return false;
+    sourceEdit.setLineProfile(std::move(profile));
+    return true;
+  }
 
 private:
+  // brings back the unsaved text of a session that crashed, on top of its
+  // file so that undo goes back to what is on disk
+  void recoverJournal() {
+    QString fileName, text, recoveredJournal;
+    const bool recovered =
+        EditJournal::recover(&fileName, &text, &recoveredJournal);
+    if (recovered) {
+      if (!fileName.isEmpty() && !sourceEdit.loadFile(fileName)) {
+        QTextCursor cursor(sourceEdit.document());
+        cursor.select(QTextCursor::Document);
+        cursor.insertText(text);
+      } else {
+        sourceEdit.document()->setPlainText(text);
+      }
+      qInfo() << "Recovered unsaved changes of"
+              << (fileName.isEmpty() ? "a new file" : fileName);
+    }
+    journal.start(sourceEdit.fileName(), !recovered, recoveredJournal);
+  }
+
+  // probing starts every compiler that is not cached yet, which may take
+  // seconds, so it is done by a worker; the symbol index is of the compiler
+  // picked once it is done
+  void detectToolchains() {
+    qputenv("path", qgetenv("path") + ";./Mingw/bin/");
+    QObject::connect(&toolchainDetection, &QFutureWatcher<void>::finished,
+                     [this]() {
+                       toolchain();
+                       loadSymbolIndex();
+                     });
+    toolchainDetection.setFuture(
+        QtConcurrent::run([]() { Toolchain::available(); }));
+  }
+
+  void loadSymbolIndex() {
+    const QString compiler = this->compiler(),
+                  path = SymbolIndex::indexPath(compiler);
+    auto useIndex = [this, path]() {
+      auto symbols = std::make_shared<SymbolIndex>();
+      if (!symbols->load(path))
+        return false;
+      completionEngine->setSymbolIndex(symbols);
+      sourceEdit.setSymbolIndex(symbols);
+      return true;
+    };
+    if (useIndex())
+      return;
+
+    // first run with this compiler, index its headers in the background
+    QObject::connect(&symbolIndexBuild, &QFutureWatcher<bool>::finished,
+                     [this, useIndex]() {
+                       if (symbolIndexBuild.result())
+                         useIndex();
+                     });
+    symbolIndexBuild.setFuture(QtConcurrent::run(
+        [compiler, path]() { return SymbolIndex::build(compiler, path); }));
+  }
+
   void parseCompilerOutput(std::vector<CompilerMsgs> &result) {
     result.clear();
-    QString o = compilationEdit.edit()->toPlainText();
+    QString o = compilationEdit().edit()->toPlainText();
     o.chop(o.size() - o.lastIndexOf('\n')); // remove last \nProgram Return...
     qDebug() << "Parsing " << o;
     auto extractInt = [](auto b) {
@@ -79,12 +492,21 @@ private:
 void MainWindow::arrangeCentralWidgetElements() {
   centralWidget()->setLayout(&details->centralWidgetVLayout);
 
-  details->runMenuTabs.addTab(details->compilationEdit.edit(), "Compilation");
-  details->runMenuTabs.addTab(details->runEdit.edit(), "Run");
-  details->runMenuTabs.setStyleSheet("margin: 5px");
+  details->runMenuTabs.setContentsMargins(5, 5, 5, 5);
 
   auto centralSplitter = new QSplitter(Qt::Vertical);
-  centralSplitter->addWidget(&details->sourceEdit);
+  centralSplitter->setHandleWidth(2);
+  auto editorPane = new QWidget;
+  auto editorPaneLayout = new QVBoxLayout(editorPane);
+  editorPaneLayout->setContentsMargins(0, 0, 0, 0);
+  editorPaneLayout->setSpacing(0);
+  auto editorRow = new QHBoxLayout;
+  editorRow->setSpacing(0);
+  editorRow->addWidget(&details->sourceEdit);
+  editorRow->addWidget(&details->minimap);
+  editorPaneLayout->addLayout(editorRow);
+  editorPaneLayout->addWidget(&details->findBar);
+  centralSplitter->addWidget(editorPane);
   centralSplitter->addWidget(&details->runMenuTabs);
   centralSplitter->setStretchFactor(0, 4);
   centralSplitter->setSizes({1000, 200});
@@ -96,9 +518,16 @@ void MainWindow::setShortCuts() {
   ui->actionSave->setShortcut(QKeySequence::Save);
   ui->actionZoom_In->setShortcut(QKeySequence::ZoomIn);
   ui->actionZoom_Out->setShortcut(QKeySequence::ZoomOut);
+  ui->actionFind->setShortcut(QKeySequence::Find);
+  ui->actionReplace->setShortcut(QKeySequence("Ctrl+H"));
+  ui->actionFind_In_Files->setShortcut(QKeySequence("Ctrl+Shift+F"));
+  ui->actionShow_Changes->setShortcut(QKeySequence("Ctrl+Shift+D"));
   ui->actionCompile->setShortcut(QKeySequence("F2"));
   ui->actionCompile_And_Run->setShortcut(QKeySequence("Ctrl+R"));
   ui->actionRun->setShortcut(QKeySequence("Ctrl+Shift+R"));
+  ui->actionQuick_Run->setShortcut(QKeySequence("F5"));
+  ui->actionRun_Tests->setShortcut(QKeySequence("Ctrl+T"));
+  ui->actionStress_Test->setShortcut(QKeySequence("Ctrl+Shift+T"));
 }
 
 void MainWindow::setMenuEdit() {
@@ -107,24 +536,123 @@ void MainWindow::setMenuEdit() {
       details->sourceEdit.zoomIn();
     else if (action == ui->actionZoom_Out)
       details->sourceEdit.zoomOut();
+    else if (action == ui->actionFind)
+      details->findBar.showFind();
+    else if (action == ui->actionReplace)
+      details->findBar.showReplace();
+    else if (action == ui->actionShow_Changes)
+      details->runMenuTabs.setCurrentWidget(&details->diff());
+    else if (action == ui->actionLanguage_Server)
+      setLanguageServer(action->isChecked());
+    else if (action == ui->actionFind_In_Files) {
+      auto &panel = details->findInFiles();
+      details->runMenuTabs.setCurrentWidget(&panel);
+      panel.activate(details->sourceEdit.textCursor().selectedText());
+    }
   });
 }
 
+void MainWindow::setLanguageServer(bool enabled) {
+  if (!details->setLanguageServer(enabled)) {
+    ui->actionLanguage_Server->setChecked(false);
+    statusBar()->showMessage(tr("clangd was not found on the path"), 5000);
+    return;
+  }
+  if (!enabled)
+    return;
+  connect(details->languageClient.get(), &LanguageClient::stopped, this,
+          [this](const QString &reason) {
+            ui->actionLanguage_Server->setChecked(false);
+            statusBar()->showMessage(reason, 5000);
+            // not from within the client's own signal
+            QMetaObject::invokeMethod(
+                this, [this]() { details->setLanguageServer(false); },
+                Qt::QueuedConnection);
+          });
+}
+
 void MainWindow::setMenuCompile() {
+  // the profile is dropped by the first edit
+  connect(&details->sourceEdit, &SourceCodeEditor::lineProfileChanged,
+          ui->actionShow_Line_Profile, &QAction::setChecked);
   connect(ui->menuRun, &QMenu::triggered, [this](QAction *action) {
     if (action == ui->actionCompile)
       details->compileSrcEdit();
     else if (action == ui->actionRun)
       details->run();
     else if (action == ui->actionCompile_And_Run) {
+      if (details->takeSpeculativeBuild()) {
+        details->run();
+        return;
+      }
       details->compileSrcEdit();
-      if (!details->compilationEdit.exitCode()) // compilation is success
+      if (!details->compilationEdit().exitCode()) // compilation is success
         details->run();
+    } else if (action == ui->actionQuick_Run) {
+      details->quickRun();
+    } else if (action == ui->actionRun_In_Terminal) {
+      details->runInTerminal = action->isChecked();
+    } else if (action == ui->actionTime_Compilation) {
+      details->timeCompilation = action->isChecked();
+    } else if (action == ui->actionRun_Tests) {
+      details->runTests();
+    } else if (action == ui->actionRun_Line_Profile) {
+      details->runWithLineProfile();
+    } else if (action == ui->actionShow_Line_Profile) {
+      if (!details->showLineProfile(action->isChecked())) {
+        action->setChecked(false);
+        statusBar()->showMessage(
+            tr("No line profile of this text, Run With Line Profile first"),
+            5000);
+      }
+    } else if (action == ui->actionStress_Test) {
+      details->runMenuTabs.setCurrentWidget(&details->stress());
     }
   });
 }
 
-QString getGlobalStyleSheet(const QColor &baseColor, const QColor &);
+void MainWindow::setMenuToolchain() {
+  // filled on first use, detection may have to start every compiler once
+  connect(ui->menuToolchain, &QMenu::aboutToShow, this, [this]() {
+    if (!ui->menuToolchain->isEmpty())
+      return;
+    auto group = new QActionGroup(ui->menuToolchain);
+    for (const auto &toolchain : Toolchain::available()) {
+      auto action = group->addAction(toolchain.name());
+      action->setCheckable(true);
+      action->setChecked(toolchain.program() ==
+                         details->toolchain().program());
+      action->setToolTip(toolchain.program());
+      connect(action, &QAction::triggered, this,
+              [this, toolchain]() { details->selectToolchain(toolchain); });
+    }
+    ui->menuToolchain->addActions(group->actions());
+    if (group->actions().isEmpty())
+      ui->menuToolchain->addAction(tr("No compiler found"))->setEnabled(false);
+  });
+}
+
+void MainWindow::setMenuDebug() {
+  connect(ui->menuDebug, &QMenu::triggered, [this](QAction *action) {
+    if (action == ui->actionMemory_Usage)
+      details->runMenuTabs.setCurrentWidget(&details->memory());
+    else if (action == ui->actionRecord_Keystrokes)
+      recordKeystrokes(action->isChecked());
+  });
+}
+
+void MainWindow::recordKeystrokes(bool record) {
+  auto &recorder = details->keystrokeRecorder;
+  if (record) {
+    recorder.start();
+    return;
+  }
+  recorder.stop();
+  auto fileName = QFileDialog::getSaveFileName(
+      this, tr("Save Keystrokes"), "./", tr("Keystroke sessions (*.keys)"));
+  if (!fileName.isEmpty() && !recorder.session().save(fileName))
+    qDebug() << "Failed to save the keystrokes to" << fileName;
+}
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent),
@@ -135,8 +663,56 @@ MainWindow::MainWindow(QWidget *parent)
   details->sourceEdit.document()->setPlainText(
       "#include <stdio.h>\n\nint main() {\n\tprintf(\"Hello World\");\n}");
 
-  setStyleSheet(
-      getGlobalStyleSheet(QColor("#3c3c3c").darker(), QColor("#2c2c2c")));
+  auto undoMemory = new QLabel;
+  statusBar()->addPermanentWidget(undoMemory);
+  connect(&details->undoHistory, &UndoHistory::memoryUsageChanged, undoMemory,
+          [undoMemory](qint64 bytes) {
+            undoMemory->setText(
+                tr("Undo: %1").arg(QLocale().formattedDataSize(bytes)));
+          });
+  details->undoHistory.reset();
+
+  auto speculation = new QLabel;
+  statusBar()->addPermanentWidget(speculation);
+  connect(&details->speculativeBuild, &SpeculativeBuild::statsChanged,
+          speculation, [this, speculation]() {
+            const auto &stats = details->speculativeBuild.stats();
+            speculation->setText(tr("Prebuilt: %1/%2")
+                                     .arg(stats.hits)
+                                     .arg(stats.hits + stats.misses));
+            speculation->setToolTip(
+                tr("Background builds: %1 started, %2 cancelled, %3 failed\n"
+                   "Compile And Run used one %4 times and compiled %5 times")
+                    .arg(stats.started)
+                    .arg(stats.cancelled)
+                    .arg(stats.failed)
+                    .arg(stats.hits)
+                    .arg(stats.misses));
+          });
+
+  auto stalls = new QLabel(tr("Stalls: 0"));
+  stalls->setToolTip(tr("Freezes of the ui over %1 ms, logged to %2")
+                         .arg(details->stallWatchdog.threshold())
+                         .arg(StallWatchdog::logPath()));
+  statusBar()->addPermanentWidget(stalls);
+  connect(&details->stallWatchdog, &StallWatchdog::stalled, stalls,
+          [this, stalls](const StallWatchdog::Stall &stall) {
+            stalls->setText(
+                tr("Stalls: %1").arg(details->stallWatchdog.stallCount()));
+            stalls->setToolTip(
+                tr("Last: %1 ms in %2\nLogged to %3")
+                    .arg(stall.milliseconds)
+                    .arg(stall.spans.isEmpty() ? tr("no span") : stall.spans)
+                    .arg(StallWatchdog::logPath()));
+          });
+
+  auto encoding = new QLabel;
+  statusBar()->addPermanentWidget(encoding);
+  connect(&details->sourceEdit, &SourceCodeEditor::fileSynced, encoding,
+          [this, encoding]() {
+            encoding->setText(details->sourceEdit.encoding().name());
+          });
+
   //  details->sourceEdit.document()->setPlainText(
   //      );
   //  setStyleSheet(details->sourceEdit.toPlainText());
@@ -152,12 +728,18 @@ MainWindow::MainWindow(QWidget *parent)
           &MainWindow::menuFileTriggered);
 
   setMenuCompile();
+  setMenuToolchain();
   setMenuEdit();
+  setMenuDebug();
   setShortCuts();
 }
 
 MainWindow::~MainWindow() { delete ui; }
 
+void MainWindow::finishStartup() { details->finishStartup(); }
+
+SourceCodeEditor *MainWindow::editor() { return &details->sourceEdit; }
+
 void MainWindow::menuFileTriggered(QAction *action) {
   if (action == ui->actionOpen) {
     auto fileName = QFileDialog::getOpenFileName(this, tr("Open File"), "./",
@@ -174,18 +756,156 @@ void MainWindow::menuFileTriggered(QAction *action) {
   }
 }
 
-void MainWindow::_Detail::run() {
-  runEdit.setProgram("./a");
+void MainWindow::_Detail::run() { runProgram("./a", {}); }
+
+void MainWindow::_Detail::runTests() {
+  compileSrcEdit();
+  auto &panel = tests();
+  runMenuTabs.setCurrentWidget(&panel);
+  if (!compilationEdit().exitCode())
+    panel.runAll("./a");
+}
+
+// compiles in memory with tcc when there is one, the regular build and run
+// otherwise
+void MainWindow::_Detail::quickRun() {
+  const Toolchain *inMemory = Toolchain::inMemory();
+  if (!inMemory) {
+    compileSrcEdit();
+    if (!compilationEdit().exitCode())
+      run();
+    return;
+  }
+  // tcc reads the source from a file so that stdin is left to the program
+  quickRunSource =
+      std::make_unique<QTemporaryFile>(QDir::tempPath() + "/quickc-XXXXXX.c");
+  if (!quickRunSource->open()) {
+    qDebug() << "Failed to write the source for" << inMemory->program();
+    return;
+  }
+  quickRunSource->write(sourceEdit.document()->toPlainText().toUtf8());
+  quickRunSource->flush();
+  runProgram(inMemory->program(),
+             inMemory->runArguments(quickRunSource->fileName()));
+}
+
+// builds with coverage counters in a directory of its own, runs the program
+// in the run console, with whatever input is typed there, and reads the
+// counts once it exits
+void MainWindow::_Detail::runWithLineProfile() {
+  TraceSpan span("compile");
+  const Toolchain &toolchain = this->toolchain();
+  auto edit = compilationEdit().edit();
+  edit->setPlainText("");
+  compileTimeReport->hide();
+  if (!toolchain.canProfileLines()) {
+    edit->setPlainText(
+        QObject::tr("%1 cannot build with coverage").arg(toolchain.name()));
+    runMenuTabs.setCurrentWidget(compilationPane.get());
+    return;
+  }
+
+  const QString src = sourceEdit.document()->toPlainText();
+  lineProfileDir = std::make_unique<QTemporaryDir>();
+  const QDir dir(lineProfileDir->path());
+  QFile source(dir.filePath("main.c"));
+  if (!lineProfileDir->isValid() || !source.open(QFile::WriteOnly)) {
+    edit->setPlainText(QObject::tr("Cannot write %1").arg(source.fileName()));
+    runMenuTabs.setCurrentWidget(compilationPane.get());
+    return;
+  }
+  source.write(src.toUtf8());
+  source.close();
+
+  for (const QStringList &arguments :
+       {toolchain.coverageCompileArguments("main.c", "main.o"),
+        toolchain.coverageLinkArguments("main.o", "profiled")}) {
+    QProcess compiler;
+    compiler.setWorkingDirectory(dir.path());
+    compiler.setProcessChannelMode(QProcess::MergedChannels);
+    compiler.start(toolchain.program(), arguments);
+    const bool finished = compiler.waitForFinished(-1);
+    const QString messages =
+        QString::fromLocal8Bit(compiler.readAll()).trimmed();
+    if (!messages.isEmpty())
+      edit->appendPlainText(messages);
+    if (!finished || compiler.exitStatus() != QProcess::NormalExit ||
+        compiler.exitCode() != 0) {
+      if (!finished)
+        edit->appendPlainText(compiler.errorString());
+      runMenuTabs.setCurrentWidget(compilationPane.get());
+      return;
+    }
+  }
+
+  lineProfileBuild = LineProfile::buildHash(toolchain.program(), src);
+  lineProfileTool = toolchain.coverageTool();
+  runProgram(dir.filePath("profiled"), {});
+  QObject::disconnect(lineProfileRun);
+  lineProfileRun = QObject::connect(
+      &runEdit(), QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+      [this]() {
+        QObject::disconnect(lineProfileRun);
+        collectLineProfile();
+      });
+}
+
+void MainWindow::_Detail::collectLineProfile() {
+  TraceSpan span("gcov");
+  if (!lineProfileDir)
+    return;
+  const QDir dir(lineProfileDir->path());
+  QProcess gcov;
+  gcov.setWorkingDirectory(dir.path());
+  gcov.start(lineProfileTool.first(), lineProfileTool.mid(1) << "main.c");
+  gcov.waitForFinished(-1);
+  QFile report(dir.filePath("main.c.gcov"));
+  LineProfile profile;
+  if (report.open(QFile::ReadOnly))
+    profile = LineProfile::fromGcov(report.readAll());
+  if (profile.isEmpty()) {
+    runEdit().edit()->appendPlainText(
+        QObject::tr("No line profile: %1 found no counts, the program has to "
+                    "exit normally to write them")
+            .arg(lineProfileTool.first()));
+    return;
+  }
+  // the counts are all that is kept of the build
+  lineProfiles.insert(lineProfileBuild,
+                      std::make_shared<const LineProfile>(std::move(profile)));
+  lineProfileDir.reset();
+  showLineProfile(true);
+}
+
+void MainWindow::_Detail::runProgram(const QString &program,
+                                     const QStringList &arguments) {
+  auto &runEdit = this->runEdit();
+  runEdit.setProgram(program);
+  runEdit.setArguments(arguments);
+  runEdit.setPtyMode(runInTerminal);
   runEdit.edit()->setPlainText("");
   runMenuTabs.setCurrentWidget(runEdit.edit());
   runEdit.start();
 }
 
 void MainWindow::_Detail::compileSrcEdit() {
+  TraceSpan span("compile");
+  auto &compilationEdit = this->compilationEdit();
   QString src = sourceEdit.document()->toPlainText();
   qDebug() << "Compiling " << src;
+  const Toolchain &toolchain = this->toolchain();
+  QStringList arguments = toolchain.compileArguments();
+  std::unique_ptr<QTemporaryDir> traceDir; // where clang writes its trace
+  if (timeCompilation && toolchain.canTimeTrace()) {
+    traceDir = std::make_unique<QTemporaryDir>();
+    arguments << "-ftime-trace=" + traceDir->path();
+  } else if (timeCompilation && toolchain.canTimeReport()) {
+    arguments << "-ftime-report";
+  }
+  compilationEdit.setProgram(toolchain.program());
+  compilationEdit.setArguments(arguments);
   compilationEdit.edit()->setPlainText("");
-  runMenuTabs.setCurrentWidget(compilationEdit.edit());
+  runMenuTabs.setCurrentWidget(compilationPane.get());
   compilationEdit.start();
   if (!compilationEdit.waitForStarted()) {
     qDebug() << "Failed to start GCC";
@@ -194,6 +914,74 @@ void MainWindow::_Detail::compileSrcEdit() {
   compilationEdit.closeWriteChannel();
   while (!compilationEdit.waitForFinished())
     ;
+  speculativeBuild.setLastCheckPassed(!compilationEdit.exitCode());
+  if (!compilationEdit.exitCode())
+    builtSource(src);
+  compileTimeReport->setVisible(timeCompilation);
+  if (timeCompilation)
+    reportCompileTimes(traceDir ? traceDir->path() : QString());
   sourceEdit.setCompilerMsgs(
       std::bind(&_Detail::parseCompilerOutput, this, std::placeholders::_1));
 }
+
+// builds another source the way the edited one is built, its messages are
+// added to the compilation console
+bool MainWindow::_Detail::compileFile(const QString &source,
+                                      const QString &output) {
+  TraceSpan span("compile");
+  auto edit = compilationEdit().edit();
+  QFile file(source);
+  if (!file.open(QFile::ReadOnly)) {
+    edit->appendPlainText(QObject::tr("Cannot read %1").arg(source));
+    return false;
+  }
+  const Toolchain &toolchain = this->toolchain();
+  QProcess compiler;
+  compiler.setProcessChannelMode(QProcess::MergedChannels);
+  compiler.start(toolchain.program(), toolchain.compileArguments(output));
+  if (!compiler.waitForStarted()) {
+    edit->appendPlainText(QObject::tr("Failed to start %1 for %2")
+                              .arg(toolchain.program())
+                              .arg(source));
+    return false;
+  }
+  compiler.write(file.readAll());
+  compiler.closeWriteChannel();
+  compiler.waitForFinished(-1);
+  const QString messages = QString::fromLocal8Bit(compiler.readAll()).trimmed();
+  if (!messages.isEmpty())
+    edit->appendPlainText(QFileInfo(source).fileName() + ":\n" + messages);
+  return compiler.exitStatus() == QProcess::NormalExit &&
+         compiler.exitCode() == 0;
+}
+
+// takes the timing report out of the console, where it would be parsed as
+// diagnostics, and adds it to the history of the file
+void MainWindow::_Detail::reportCompileTimes(const QString &traceDir) {
+  CompileTimes times;
+  bool found = false;
+  if (!traceDir.isEmpty()) {
+    const auto traces = QDir(traceDir).entryInfoList({"*.json"}, QDir::Files);
+    QFile trace(traces.value(0).filePath());
+    found = trace.open(QFile::ReadOnly) &&
+            CompileTimes::fromClangTrace(trace.readAll(), &times);
+  } else {
+    auto edit = compilationEdit().edit();
+    QString output = edit->toPlainText();
+    int start, end;
+    found = CompileTimes::fromGccReport(output, &times, &start, &end);
+    if (found) {
+      output.remove(start, end - start);
+      edit->setPlainText(output.trimmed());
+    }
+  }
+  if (!found) {
+    compileTimeSummary->setText(QObject::tr("No timing report"));
+    return;
+  }
+  times.timestamp = QDateTime::currentMSecsSinceEpoch();
+  compileTimeHistory.add(sourceEdit.fileName(), times);
+  compileTimeSummary->setText(times.summary());
+  compileTimeGraph->setBuilds(
+      compileTimeHistory.builds(sourceEdit.fileName()));
+}
@@ -4,6 +4,8 @@
 #include <QMainWindow>
 #include <memory>
 
+class SourceCodeEditor;
+
 namespace Ui {
 class MainWindow;
 }
@@ -19,6 +21,12 @@ public:
 
   void setMenuEdit();
 
+  // sets up what was left out of the constructor to get the window up fast
+  void finishStartup();
+
+  // the editor, for driving it without the window system
+  SourceCodeEditor *editor();
+
 private:
   Ui::MainWindow *ui;
 
@@ -28,6 +36,10 @@ private:
   void menuFileTriggered(QAction *);
   void arrangeCentralWidgetElements();
   void setMenuCompile();
+  void setMenuToolchain();
+  void setMenuDebug();
+  void recordKeystrokes(bool record);
+  void setLanguageServer(bool enabled);
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,60 @@
+#include "memorypanel.h"
+#include "memoryregistry.h"
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLocale>
+
+MemoryPanel::MemoryPanel(QWidget *parent)
+    : QWidget(parent), m_trim{tr("Trim")} {
+  m_sources.setColumnCount(2);
+  m_sources.setHeaderLabels({tr("Source"), tr("Estimated size")});
+  m_sources.setRootIsDecorated(false);
+  m_sources.header()->setSectionResizeMode(0, QHeaderView::Stretch);
+  m_trim.setToolTip(tr("Release caches and the layout of off screen text"));
+
+  auto bottom = new QHBoxLayout;
+  bottom->addWidget(&m_resident, 1);
+  bottom->addWidget(&m_trim);
+  m_layout.setContentsMargins(0, 0, 0, 0);
+  m_layout.addWidget(&m_sources);
+  m_layout.addLayout(bottom);
+  setLayout(&m_layout);
+
+  connect(&m_trim, &QPushButton::clicked, [this]() {
+    MemoryRegistry::instance().trim();
+    refresh();
+  });
+  m_refreshTimer.setInterval(1000);
+  connect(&m_refreshTimer, &QTimer::timeout, this, &MemoryPanel::refresh);
+}
+
+void MemoryPanel::showEvent(QShowEvent *event) {
+  refresh();
+  m_refreshTimer.start();
+  QWidget::showEvent(event);
+}
+
+void MemoryPanel::hideEvent(QHideEvent *event) {
+  m_refreshTimer.stop(); // the estimates walk every block
+  QWidget::hideEvent(event);
+}
+
+void MemoryPanel::refresh() {
+  const QLocale locale;
+  const auto report = MemoryRegistry::instance().report();
+  qint64 total = 0;
+  m_sources.clear();
+  for (const auto &source : report) {
+    new QTreeWidgetItem(&m_sources, {source.first, locale.formattedDataSize(
+                                                       source.second)});
+    total += source.second;
+  }
+
+  const qint64 resident = MemoryRegistry::residentBytes();
+  m_resident.setText(
+      resident < 0
+          ? tr("Accounted: %1").arg(locale.formattedDataSize(total))
+          : tr("Accounted: %1 of %2 resident")
+                .arg(locale.formattedDataSize(total))
+                .arg(locale.formattedDataSize(resident)));
+}
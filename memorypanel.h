@@ -0,0 +1,32 @@
+#ifndef MEMORYPANEL_H
+#define MEMORYPANEL_H
+
+#include <QLabel>
+#include <QPushButton>
+#include <QTimer>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+#include <QWidget>
+
+// what the sources of the MemoryRegistry hold next to the resident size of
+// the process, refreshed while the panel is shown
+class MemoryPanel : public QWidget {
+  Q_OBJECT
+public:
+  explicit MemoryPanel(QWidget *parent = nullptr);
+
+protected:
+  void showEvent(QShowEvent *event) override;
+  void hideEvent(QHideEvent *event) override;
+
+private:
+  QVBoxLayout m_layout;
+  QTreeWidget m_sources;
+  QLabel m_resident;
+  QPushButton m_trim;
+  QTimer m_refreshTimer;
+
+  void refresh();
+};
+
+#endif // MEMORYPANEL_H
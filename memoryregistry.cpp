@@ -0,0 +1,97 @@
+#include "memoryregistry.h"
+#include <QFile>
+#include <QObject>
+#include <QPlainTextEdit>
+#include <QTextBlock>
+#include <QTextDocument>
+#include <QTextLayout>
+#include <algorithm>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+namespace {
+// rough costs of Qt's internals, from the sizes of their private structures
+const qint64 blockOverhead = 96;  // fragment and block data
+const qint64 lineOverhead = 48;   // QScriptLine
+const qint64 glyphBytes = 24;     // glyphs, advances, offsets and attributes
+const qint64 formatOverhead = 40; // QTextLayout::FormatRange
+} // namespace
+
+MemoryRegistry &MemoryRegistry::instance() {
+  static MemoryRegistry registry;
+  return registry;
+}
+
+void MemoryRegistry::add(QObject *owner, const QString &name, Reporter bytes,
+                         Trimmer trim) {
+  m_sources.push_back({owner, name, std::move(bytes), std::move(trim)});
+  QObject::connect(owner, &QObject::destroyed, [this, owner]() {
+    m_sources.erase(std::remove_if(m_sources.begin(), m_sources.end(),
+                                   [owner](const Source &source) {
+                                     return source.owner == owner;
+                                   }),
+                    m_sources.end());
+  });
+}
+
+QVector<QPair<QString, qint64>> MemoryRegistry::report() const {
+  QVector<QPair<QString, qint64>> result;
+  for (const auto &source : m_sources)
+    result.push_back({source.name, source.bytes()});
+  return result;
+}
+
+void MemoryRegistry::trim() {
+  for (const auto &source : m_sources)
+    if (source.trim)
+      source.trim();
+#ifdef __GLIBC__
+  malloc_trim(0);
+#endif
+}
+
+qint64 MemoryRegistry::residentBytes() {
+  QFile status("/proc/self/status");
+  if (!status.open(QFile::ReadOnly))
+    return -1;
+  for (QByteArray line; !(line = status.readLine()).isEmpty();)
+    if (line.startsWith("VmRSS:")) // in kB
+      return line.mid(6).trimmed().split(' ').value(0).toLongLong() * 1024;
+  return -1;
+}
+
+qint64 MemoryRegistry::textBytes(const QTextDocument *document) {
+  return qint64(document->characterCount()) * qint64(sizeof(QChar)) +
+         qint64(document->blockCount()) * blockOverhead;
+}
+
+qint64 MemoryRegistry::layoutBytes(const QTextDocument *document) {
+  qint64 bytes = 0;
+  for (auto block = document->begin(); block.isValid(); block = block.next()) {
+    const QTextLayout *layout = block.layout();
+    if (!layout)
+      continue;
+    bytes += layout->formats().size() * formatOverhead;
+    if (layout->lineCount())
+      bytes += layout->lineCount() * lineOverhead + block.length() * glyphBytes;
+  }
+  return bytes;
+}
+
+void MemoryRegistry::releaseLayouts(QPlainTextEdit *edit) {
+  const QTextBlock first = edit->firstVisibleBlock();
+  // a screen's worth of margin, so scrolling a little does not relayout
+  const int visible = edit->viewport()->height() /
+                          std::max(1, edit->fontMetrics().height()) +
+                      1;
+  const int keepFrom = first.blockNumber() - visible,
+            keepTo = first.blockNumber() + 2 * visible;
+  const int cursorBlock = edit->textCursor().blockNumber();
+  int number = 0;
+  for (auto block = edit->document()->begin(); block.isValid();
+       block = block.next(), ++number)
+    if ((number < keepFrom || number > keepTo) && number != cursorBlock &&
+        block.layout()->lineCount())
+      block.layout()->clearLayout();
+}
@@ -0,0 +1,49 @@
+#ifndef MEMORYREGISTRY_H
+#define MEMORYREGISTRY_H
+
+#include <QPair>
+#include <QString>
+#include <QVector>
+#include <functional>
+
+class QObject;
+class QPlainTextEdit;
+class QTextDocument;
+
+// the parts of the program holding a lot of memory, each reporting what it
+// holds and optionally able to give some of it back
+class MemoryRegistry {
+public:
+  using Reporter = std::function<qint64()>;
+  using Trimmer = std::function<void()>;
+
+  static MemoryRegistry &instance();
+
+  // the source is dropped again when owner is destroyed
+  void add(QObject *owner, const QString &name, Reporter bytes,
+           Trimmer trim = {});
+  QVector<QPair<QString, qint64>> report() const;
+  // runs every trimmer and hands freed heap back to the system
+  void trim();
+
+  // resident set size of the process, -1 where it is not known
+  static qint64 residentBytes();
+
+  // estimates for the parts of a document Qt does not account for
+  static qint64 textBytes(const QTextDocument *document);
+  static qint64 layoutBytes(const QTextDocument *document);
+  // drops the line layouts of the blocks of edit that are off screen, they
+  // are laid out again when scrolled to
+  static void releaseLayouts(QPlainTextEdit *edit);
+
+private:
+  struct Source {
+    QObject *owner;
+    QString name;
+    Reporter bytes;
+    Trimmer trim;
+  };
+  QVector<Source> m_sources;
+};
+
+#endif // MEMORYREGISTRY_H
@@ -0,0 +1,236 @@
+#include "minimap.h"
+#include "documentedits.h"
+#include "sourcecodeeditor.h"
+#include "theme.h"
+#include <QFutureWatcher>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QScrollBar>
+#include <QTextBlock>
+#include <QtConcurrent>
+#include <algorithm>
+#include <climits>
+
+namespace {
+// what a worker needs of a line, copied on the gui thread
+struct Line {
+  QString text;
+  QVector<Token> tokens;
+};
+
+QImage renderTile(const QVector<Line> &lines, QRgb text,
+                  const QVector<QRgb> &tokenColors) {
+  QImage image(Minimap::columns, Minimap::tileLines * Minimap::lineHeight,
+               QImage::Format_ARGB32_Premultiplied);
+  image.fill(Qt::transparent);
+  const int tabStop = 4;
+  QVector<QRgb> colours;
+  for (int l = 0; l < lines.size(); ++l) {
+    const Line &line = lines[l];
+    colours.fill(text, line.text.size());
+    for (const auto &t : line.tokens)
+      for (int i = t.start; i < t.start + t.length && i < colours.size(); ++i)
+        colours[i] = tokenColors[t.tokenClass];
+
+    // one pixel per column, the last row of a line is left as spacing
+    auto row = reinterpret_cast<QRgb *>(
+        image.scanLine(l * Minimap::lineHeight));
+    for (int i = 0, column = 0;
+         i < line.text.size() && column < Minimap::columns; ++i) {
+      const QChar c = line.text[i];
+      if (c == '\t') {
+        column += tabStop - column % tabStop;
+        continue;
+      }
+      if (!c.isSpace())
+        row[column] = colours[i];
+      ++column;
+    }
+  }
+  return image;
+}
+} // namespace
+
+Minimap::Minimap(SourceCodeEditor *editor, CppSyntaxHightlighter *highlighter,
+                 QWidget *parent)
+    : QWidget(parent), m_editor{editor} {
+  const Theme &theme = Theme::dark();
+  m_background = theme.editorPalette.color(QPalette::Base);
+  m_text = theme.editorPalette.color(QPalette::Text);
+  m_text.setAlpha(160);
+  for (int c = 0; c < TokenClassCount; ++c)
+    m_tokenColors[c] = theme.tokenFormats[c].foreground().color();
+  setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Expanding);
+  setCursor(Qt::PointingHandCursor);
+
+  auto document = m_editor->document();
+  m_blockCount = document->blockCount();
+  m_tiles.resize(m_blockCount / tileLines + 1);
+  connect(DocumentEdits::of(document), &DocumentEdits::edited, this,
+          [this, document](int position, int, int charsAdded) {
+            const int first = document->findBlock(position).blockNumber();
+            if (document->blockCount() == m_blockCount) {
+              invalidate(first, document->findBlock(position + charsAdded)
+                                    .blockNumber());
+              return;
+            }
+            // lines were added or removed, the ones below have moved
+            m_blockCount = document->blockCount();
+            m_tiles.resize(m_blockCount / tileLines + 1);
+            invalidate(first, -1);
+          });
+  connect(highlighter, &CppSyntaxHightlighter::blockHighlighted, this,
+          [this](const QTextBlock &block) {
+            invalidate(block.blockNumber(), block.blockNumber());
+          });
+  connect(m_editor->verticalScrollBar(), &QScrollBar::valueChanged, this,
+          QOverload<>::of(&Minimap::update));
+  connect(m_editor, &SourceCodeEditor::compilerMsgsChanged, this,
+          QOverload<>::of(&Minimap::update));
+}
+
+QSize Minimap::sizeHint() const { return {columns, 100}; }
+
+int Minimap::topBlock() const {
+  const QTextBlock block = m_editor->document()->findBlockByLineNumber(
+      m_editor->verticalScrollBar()->value());
+  return block.isValid() ? block.blockNumber() : 0;
+}
+
+int Minimap::bottomBlock() const {
+  const QScrollBar *bar = m_editor->verticalScrollBar();
+  const QTextBlock block = m_editor->document()->findBlockByLineNumber(
+      bar->value() + std::max(bar->pageStep(), 1) - 1);
+  return block.isValid() ? block.blockNumber()
+                         : m_editor->document()->blockCount() - 1;
+}
+
+int Minimap::contentOffset() const {
+  const QScrollBar *bar = m_editor->verticalScrollBar();
+  const int overflow =
+      m_editor->document()->blockCount() * lineHeight - height();
+  const int lastTop =
+      m_editor->document()->findBlockByLineNumber(bar->maximum()).blockNumber();
+  if (overflow <= 0 || lastTop <= 0)
+    return 0;
+  return int(qint64(overflow) * std::min(topBlock(), lastTop) / lastTop);
+}
+
+void Minimap::invalidate(int firstBlock, int lastBlock) {
+  if (lastBlock < 0)
+    lastBlock = INT_MAX;
+  if (m_dirtyFirst < 0) {
+    m_dirtyFirst = firstBlock;
+    m_dirtyLast = lastBlock;
+  } else {
+    m_dirtyFirst = std::min(m_dirtyFirst, firstBlock);
+    m_dirtyLast = std::max(m_dirtyLast, lastBlock);
+  }
+  if (!m_invalidatePending) {
+    m_invalidatePending = true;
+    QMetaObject::invokeMethod(this, &Minimap::invalidatePending,
+                              Qt::QueuedConnection);
+  }
+}
+
+void Minimap::invalidatePending() {
+  m_invalidatePending = false;
+  if (m_dirtyFirst < 0)
+    return;
+  const int last = std::min(m_dirtyLast / tileLines, m_tiles.size() - 1);
+  for (int t = std::max(m_dirtyFirst, 0) / tileLines; t <= last; ++t)
+    ++m_tiles[t].generation;
+  m_dirtyFirst = m_dirtyLast = -1;
+  update();
+}
+
+void Minimap::drawTile(int index) {
+  Tile &tile = m_tiles[index];
+  tile.drawing = true;
+  const quint64 generation = tile.generation;
+
+  QVector<Line> lines;
+  lines.reserve(tileLines);
+  QTextBlock block =
+      m_editor->document()->findBlockByNumber(index * tileLines);
+  for (int l = 0; l < tileLines && block.isValid();
+       ++l, block = block.next()) {
+    auto data = static_cast<HighlighterBlockData *>(block.userData());
+    lines.push_back({block.text(), data ? data->tokens() : QVector<Token>()});
+  }
+  QVector<QRgb> tokenColors;
+  for (const auto &c : m_tokenColors)
+    tokenColors << c.rgba();
+
+  auto watcher = new QFutureWatcher<QImage>(this);
+  connect(watcher, &QFutureWatcher<QImage>::finished, [=]() {
+    watcher->deleteLater();
+    if (index >= m_tiles.size())
+      return; // the document shrank meanwhile
+    Tile &tile = m_tiles[index];
+    tile.drawing = false;
+    tile.image = watcher->result();
+    tile.drawn = generation;
+    update(); // draws it again if it changed meanwhile
+  });
+  const QRgb text = m_text.rgba();
+  watcher->setFuture(QtConcurrent::run(
+      [=]() { return renderTile(lines, text, tokenColors); }));
+}
+
+void Minimap::paintEvent(QPaintEvent *) {
+  QPainter painter(this);
+  painter.fillRect(rect(), m_background);
+
+  const int offset = contentOffset(), tileHeight = tileLines * lineHeight;
+  const int lastTile =
+      std::min((offset + height()) / tileHeight, m_tiles.size() - 1);
+  for (int t = offset / tileHeight; t <= lastTile; ++t) {
+    Tile &tile = m_tiles[t];
+    if (tile.drawn != tile.generation && !tile.drawing)
+      drawTile(t);
+    if (!tile.image.isNull()) // outdated ones are better than a gap
+      painter.drawImage(0, t * tileHeight - offset, tile.image);
+  }
+
+  // the part the editor shows
+  const int top = topBlock();
+  QColor shade = m_text;
+  shade.setAlpha(40);
+  painter.fillRect(0, top * lineHeight - offset, width(),
+                   (bottomBlock() - top + 1) * lineHeight, shade);
+
+  for (const auto &msg : m_editor->compilerMsgs()) {
+    if (msg.msgSeverity == CompilerMsgs::Unknown)
+      continue;
+    const int y = int(msg.lineNo - 1) * lineHeight - offset;
+    painter.fillRect(width() - 4, y - 1, 4, 4,
+                     msg.msgSeverity == CompilerMsgs::Error
+                         ? QColor(Qt::red)
+                         : QColor(Qt::yellow));
+  }
+}
+
+void Minimap::scrollEditorTo(int y) {
+  // the block under y goes to the middle of the editor
+  const int block = (y + contentOffset()) / lineHeight -
+                    (bottomBlock() - topBlock()) / 2;
+  m_editor->verticalScrollBar()->setValue(
+      m_editor->document()
+          ->findBlockByNumber(
+              qBound(0, block, m_editor->document()->blockCount() - 1))
+          .firstLineNumber());
+}
+
+void Minimap::mousePressEvent(QMouseEvent *event) {
+  scrollEditorTo(event->pos().y());
+}
+
+void Minimap::mouseMoveEvent(QMouseEvent *event) {
+  if (event->buttons() & Qt::LeftButton)
+    scrollEditorTo(event->pos().y());
+}
+
+void Minimap::wheelEvent(QWheelEvent *event) {
+  QCoreApplication::sendEvent(m_editor->viewport(), event);
+}
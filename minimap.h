@@ -0,0 +1,62 @@
+#ifndef MINIMAP_H
+#define MINIMAP_H
+
+#include "cppsyntaxhightlighter.h"
+#include <QImage>
+#include <QVector>
+#include <QWidget>
+
+class SourceCodeEditor;
+
+// scaled down picture of the whole document next to the editor, coloured by
+// token class and marked with the compiler's diagnostics; the picture is cut
+// into tiles of a fixed number of lines, drawn on worker threads and redrawn
+// only when one of their lines changes
+class Minimap : public QWidget {
+  Q_OBJECT
+public:
+  Minimap(SourceCodeEditor *editor, CppSyntaxHightlighter *highlighter,
+          QWidget *parent = nullptr);
+
+  QSize sizeHint() const override;
+
+  static constexpr int lineHeight = 2, tileLines = 256, columns = 120;
+
+protected:
+  void paintEvent(QPaintEvent *event) override;
+  void mousePressEvent(QMouseEvent *event) override;
+  void mouseMoveEvent(QMouseEvent *event) override;
+  void wheelEvent(QWheelEvent *event) override;
+
+private:
+  struct Tile {
+    QImage image; // may be outdated while a new one is drawn
+    quint64 generation = 0; // bumped whenever a line of the tile changes
+    quint64 drawn = quint64(-1); // the generation image shows
+    bool drawing = false;
+  };
+
+  SourceCodeEditor *m_editor;
+  QVector<Tile> m_tiles;
+  int m_blockCount;
+  // blocks changed since the tiles were last invalidated, which happens
+  // once per event loop turn however many blocks the highlighter reports
+  int m_dirtyFirst = -1, m_dirtyLast = -1;
+  bool m_invalidatePending = false;
+  QColor m_background, m_text, m_tokenColors[TokenClassCount];
+
+  // the blocks at the top and the bottom of the editor; its scroll bar
+  // counts the lines of the layout, which are more than the blocks once long
+  // ones are wrapped
+  int topBlock() const;
+  int bottomBlock() const;
+  // y of the first line shown, the minimap scrolls along with the editor
+  int contentOffset() const;
+  // lastBlock -1 is up to the end of the document
+  void invalidate(int firstBlock, int lastBlock);
+  void invalidatePending();
+  void drawTile(int index);
+  void scrollEditorTo(int y);
+};
+
+#endif // MINIMAP_H
@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += core gui
+QT       += core gui concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -30,14 +30,86 @@ SOURCES += \
         mainwindow.cpp \
         sourcecodeeditor.cpp \
         editprocess.cpp \
-        cppsyntaxhightlighter.cpp
+        cppsyntaxhightlighter.cpp \
+        completionengine.cpp \
+        symbolindex.cpp \
+        filecache.cpp \
+        theme.cpp \
+        startupprofile.cpp \
+        undohistory.cpp \
+        documentedits.cpp \
+        textsearch.cpp \
+        findbar.cpp \
+        filesearch.cpp \
+        findinfilespanel.cpp \
+        linediff.cpp \
+        editjournal.cpp \
+        textencoding.cpp \
+        memoryregistry.cpp \
+        memorypanel.cpp \
+        minimap.cpp \
+        testrunner.cpp \
+        testpanel.cpp \
+        stresstester.cpp \
+        stresspanel.cpp \
+        languageclient.cpp \
+        lineprofile.cpp \
+        stallwatchdog.cpp \
+        compiletimes.cpp \
+        compiletimegraph.cpp \
+        toolchain.cpp \
+        speculativebuild.cpp \
+        bufferdiff.cpp \
+        diffpanel.cpp \
+        keystrokesession.cpp \
+        benchmark.cpp
 
 HEADERS += \
         mainwindow.h \
         sourcecodeeditor.h \
         editprocess.h \
         cppsyntaxhightlighter.h \
-    linenumber.h
+    linenumber.h \
+    completionengine.h \
+    symbolindex.h \
+    filecache.h \
+    theme.h \
+    startupprofile.h \
+    undohistory.h \
+    documentedits.h \
+    textsearch.h \
+    findbar.h \
+    filesearch.h \
+    findinfilespanel.h \
+    linediff.h \
+    editjournal.h \
+    textencoding.h \
+    memoryregistry.h \
+    memorypanel.h \
+    minimap.h \
+    testrunner.h \
+    testpanel.h \
+    stresstester.h \
+    stresspanel.h \
+    languageclient.h \
+    lineprofile.h \
+    stallwatchdog.h \
+    compiletimes.h \
+    compiletimegraph.h \
+    toolchain.h \
+    speculativebuild.h \
+    bufferdiff.h \
+    diffpanel.h \
+    keystrokesession.h \
+    benchmark.h
+
+# openpty, for running programs on a pseudo terminal
+unix:!macx: LIBS += -lutil
+
+# names in the backtraces of the stall log, which are walked along the
+# frame pointers
+unix: QMAKE_LFLAGS += -rdynamic
+unix: QMAKE_CXXFLAGS += -fno-omit-frame-pointer
 
 FORMS += \
         mainwindow.ui
@@ -1,15 +1,33 @@
 #include "sourcecodeeditor.h"
+#include "bufferdiff.h"
+#include "completionengine.h"
+#include "cppsyntaxhightlighter.h"
+#include "documentedits.h"
+#include "filecache.h"
+#include "languageclient.h"
+#include "linediff.h"
 #include "linenumber.h"
+#include "lineprofile.h"
+#include "stallwatchdog.h"
+#include "symbolindex.h"
+#include "textsearch.h"
+#include "theme.h"
+#include "undohistory.h"
 #include <QAbstractItemView>
+#include <QCryptographicHash>
 #include <QDebug>
 #include <QFile>
+#include <QFileInfo>
 #include <QFont>
 #include <QFontMetrics>
 #include <QKeyEvent>
+#include <QMenu>
+#include <QMessageBox>
 #include <QPainter>
 #include <QScrollBar>
 #include <QTextBlock>
 #include <QToolTip>
+#include <QtConcurrent>
 #include <cmath>
 #include <stack>
 
@@ -37,6 +55,40 @@ void SourceCodeEditor::setTabSize(const int tabStop) {
   setTabStopDistance(ceil(stopWidth));
 }
 
+void SourceCodeEditor::setHighlighter(CppSyntaxHightlighter *highlighter) {
+  m_highlighter = highlighter;
+}
+
+void SourceCodeEditor::setUndoHistory(UndoHistory *history) {
+  m_undoHistory = history;
+}
+
+void SourceCodeEditor::undoOrRedo(bool undo) {
+  auto tc = textCursor();
+  if (undo)
+    m_undoHistory->undo(&tc);
+  else
+    m_undoHistory->redo(&tc);
+  setTextCursor(tc);
+}
+
+void SourceCodeEditor::contextMenuEvent(QContextMenuEvent *e) {
+  std::unique_ptr<QMenu> menu{createStandardContextMenu(e->pos())};
+  // the standard undo and redo act on the document's own stacks, which miss
+  // the steps compacted into snapshots
+  for (QAction *action : menu->actions()) {
+    const bool undo = action->objectName() == "edit-undo";
+    if (!m_undoHistory || (!undo && action->objectName() != "edit-redo"))
+      continue;
+    QObject::disconnect(action, &QAction::triggered, nullptr, nullptr);
+    action->setEnabled(undo ? m_undoHistory->isUndoAvailable()
+                            : m_undoHistory->isRedoAvailable());
+    connect(action, &QAction::triggered, this,
+            [this, undo]() { undoOrRedo(undo); });
+  }
+  menu->exec(e->globalPos());
+}
+
 void SourceCodeEditor::setCompleter(QCompleter *completer) {
   if (c)
     QObject::disconnect(c, 0, this, 0);
@@ -47,23 +99,146 @@ void SourceCodeEditor::setCompleter(QCompleter *completer) {
     return;
 
   c->setWidget(this);
-  c->setCompletionMode(QCompleter::PopupCompletion);
-  c->setCaseSensitivity(Qt::CaseInsensitive);
+  // candidates are already filtered and ranked by the completion engine
+  c->setCompletionMode(QCompleter::UnfilteredPopupCompletion);
   QObject::connect(c, SIGNAL(activated(QString)), this,
                    SLOT(insertCompletion(QString)));
 }
 
 QCompleter *SourceCodeEditor::completer() const { return c; }
 
+void SourceCodeEditor::setCompletionEngine(CompletionEngine *engine) {
+  if (m_completionEngine)
+    QObject::disconnect(m_completionEngine, 0, this, 0);
+
+  m_completionEngine = engine;
+
+  if (!m_completionEngine)
+    return;
+
+  connect(m_completionEngine, &CompletionEngine::completionsReady, this,
+          &SourceCodeEditor::showCompletions);
+}
+
+void SourceCodeEditor::setSymbolIndex(
+    std::shared_ptr<const SymbolIndex> symbols) {
+  m_symbolIndex = std::move(symbols);
+}
+
+void SourceCodeEditor::setLanguageClient(LanguageClient *client) {
+  if (m_languageClient)
+    QObject::disconnect(m_languageClient, 0, this, 0);
+
+  m_languageClient = client;
+  m_semanticSelections.clear();
+  highlightCurrentLine();
+
+  if (!m_languageClient)
+    return;
+
+  connect(client, &LanguageClient::ready, this,
+          [this]() { m_semanticTokensTimer.start(); });
+  connect(client, &LanguageClient::completionsReady, this,
+          [this](const QString &prefix, const QStringList &completions) {
+            if (m_completionEngine)
+              m_completionEngine->addServerCompletions(prefix, completions);
+          });
+  connect(client, &LanguageClient::hoverReady, this,
+          [this](int position, const QString &text) {
+            if (position == m_hoverPosition && viewport()->underMouse())
+              QToolTip::showText(m_hoverGlobalPos, text, this);
+          });
+  connect(client, &LanguageClient::diagnosticsReady, this,
+          [this](const QVector<LanguageClient::Diagnostic> &diagnostics) {
+            setCompilerMsgs([&diagnostics](std::vector<CompilerMsgs> &msgs) {
+              msgs.clear();
+              for (const auto &diagnostic : diagnostics)
+                msgs.push_back({diagnostic.line, diagnostic.column,
+                                diagnostic.message,
+                                diagnostic.error ? CompilerMsgs::Error
+                                                 : CompilerMsgs::Warning});
+            });
+          });
+  connect(client, &LanguageClient::semanticTokensReady, this,
+          [this](const QVector<LanguageClient::SemanticToken> &tokens) {
+            const auto &formats = Theme::dark().semanticFormats;
+            m_semanticSelections.clear();
+            QTextEdit::ExtraSelection selection;
+            selection.cursor = QTextCursor(document());
+            for (const auto &token : tokens) {
+              auto format = formats.constFind(token.type);
+              const QTextBlock block =
+                  document()->findBlockByNumber(token.line);
+              if (format == formats.cend() || !block.isValid() ||
+                  token.column + token.length >= block.length())
+                continue;
+              selection.format = *format;
+              selection.cursor.setPosition(block.position() + token.column);
+              selection.cursor.setPosition(block.position() + token.column +
+                                               token.length,
+                                           QTextCursor::KeepAnchor);
+              m_semanticSelections.append(selection);
+            }
+            highlightCurrentLine();
+          });
+}
+
+void SourceCodeEditor::setLineProfile(
+    std::shared_ptr<const LineProfile> profile) {
+  const bool changed = profile != m_lineProfile;
+  m_lineProfile = std::move(profile);
+  if (!changed)
+    return;
+  lineNumberArea->update();
+  emit lineProfileChanged(m_lineProfile != nullptr);
+}
+
+// only the lines on screen, the rest are asked for when scrolled to
+void SourceCodeEditor::requestSemanticTokens() {
+  if (!m_languageClient || !m_languageClient->isReady())
+    return;
+  const int last =
+      cursorForPosition(viewport()->rect().bottomLeft()).blockNumber();
+  m_languageClient->requestSemanticTokens(firstVisibleBlock().blockNumber(),
+                                          last);
+}
+
 void SourceCodeEditor::insertCompletion(const QString &completion) {
   if (c->widget() != this)
     return;
+  // a fuzzy match need not share its prefix, so replace the typed word
   QTextCursor tc = textCursor();
-  int extra = completion.length() - c->completionPrefix().length();
   tc.movePosition(QTextCursor::Left);
   tc.movePosition(QTextCursor::EndOfWord);
-  tc.insertText(completion.right(extra));
+  tc.movePosition(QTextCursor::PreviousCharacter, QTextCursor::KeepAnchor,
+                  m_completionPrefix.length());
+  tc.insertText(completion);
   setTextCursor(tc);
+  m_completionPrefix = completion;
+}
+
+void SourceCodeEditor::showCompletions(const QString &prefix, int count) {
+  if (!c || prefix != m_completionPrefix) // stale results
+    return;
+  if (!count) {
+    c->popup()->hide();
+    return;
+  }
+
+  // only the few ranked rows are measured, not the whole word list
+  const QFontMetrics fm(c->popup()->font());
+  auto model = m_completionEngine->model();
+  for (int row = 0; row < count; ++row)
+    m_completionPopupWidth = std::max(
+        m_completionPopupWidth,
+        fm.horizontalAdvance(model->index(row).data().toString()) +
+            fm.horizontalAdvance(QLatin1Char('9')) * 2);
+
+  QRect cr = cursorRect();
+  cr.setWidth(m_completionPopupWidth +
+              c->popup()->verticalScrollBar()->sizeHint().width());
+  c->complete(cr); // popup it up!
+  c->popup()->setCurrentIndex(c->completionModel()->index(0, 0));
 }
 
 QString SourceCodeEditor::textUnderCursor() const {
@@ -72,6 +247,11 @@ QString SourceCodeEditor::textUnderCursor() const {
   return tc.selectedText();
 }
 
+void SourceCodeEditor::paintEvent(QPaintEvent *e) {
+  TraceSpan span("paint");
+  QPlainTextEdit::paintEvent(e);
+}
+
 void SourceCodeEditor::focusInEvent(QFocusEvent *e) {
   if (c)
     c->setWidget(this);
@@ -93,8 +273,65 @@ SourceCodeEditor::SourceCodeEditor(QWidget *paren) : QPlainTextEdit{paren} {
   setTabSize(tabStop);
 
   setCursorWidth(10);
+
+  // a paste or cut of a long line, checked once the edit is done
+  connect(document(), &QTextDocument::contentsChange, this,
+          [this](int, int charsRemoved, int charsAdded) {
+            const int threshold = CppSyntaxHightlighter::longLineThreshold;
+            if (charsAdded > threshold ||
+                (m_longLineMode && charsRemoved > threshold))
+              QMetaObject::invokeMethod(this,
+                                        &SourceCodeEditor::updateLongLineMode,
+                                        Qt::QueuedConnection);
+          });
+  connect(horizontalScrollBar(), &QScrollBar::valueChanged, this,
+          &SourceCodeEditor::updateLongLineWindow);
+  connect(verticalScrollBar(), &QScrollBar::valueChanged, this,
+          &SourceCodeEditor::updateLongLineWindow);
+  // the tokens around an edit are lexed again once it is done
+  connect(DocumentEdits::of(document()), &DocumentEdits::edited, this,
+          [this]() {
+            if (!m_longLineMode)
+              return;
+            m_longLineTop = -1;
+            QMetaObject::invokeMethod(this,
+                                      &SourceCodeEditor::updateLongLineWindow,
+                                      Qt::QueuedConnection);
+          });
+
+  m_semanticTokensTimer.setSingleShot(true);
+  m_semanticTokensTimer.setInterval(150);
+  connect(&m_semanticTokensTimer, &QTimer::timeout, this,
+          &SourceCodeEditor::requestSemanticTokens);
+  auto visibleTextChanged = [this]() {
+    if (m_languageClient)
+      m_semanticTokensTimer.start();
+  };
+  connect(verticalScrollBar(), &QScrollBar::valueChanged, this,
+          visibleTextChanged);
+  connect(document(), &QTextDocument::contentsChange, this,
+          visibleTextChanged);
+  // the counts are of the lines as they were run; highlighting changes
+  // formats only and leaves them valid
+  connect(DocumentEdits::of(document()), &DocumentEdits::edited, this,
+          [this]() {
+            if (m_lineProfile)
+              setLineProfile(nullptr);
+          });
+
+  connect(&m_fileWatcher, &QFileSystemWatcher::fileChanged,
+          [this](const QString &fileName) {
+            if (fileName != m_fileName)
+              return;
+            // rewritten by replacing it, which ends the watch
+            if (!m_fileWatcher.files().contains(fileName))
+              m_fileWatcher.addPath(fileName);
+            fileChangedOnDisk();
+          });
 }
 
+SourceCodeEditor::~SourceCodeEditor() { m_cacheWrite.waitForFinished(); }
+
 int SourceCodeEditor::lineNumberAreaWidth() {
   /*
    * calculates the lineNumberArea width by counting the digits of number of
@@ -143,13 +380,94 @@ void SourceCodeEditor::resizeEvent(QResizeEvent *e) {
   QRect cr = contentsRect();
   lineNumberArea->setGeometry(
       QRect(cr.left(), cr.top(), lineNumberAreaWidth(), cr.height()));
+  updateLongLineWindow();
+  if (m_languageClient)
+    m_semanticTokensTimer.start();
+}
+
+void SourceCodeEditor::updateLongLineMode() {
+  bool longLines = false;
+  for (auto block = document()->begin(); block.isValid() && !longLines;
+       block = block.next())
+    longLines = block.length() > CppSyntaxHightlighter::longLineThreshold;
+  if (longLines == m_longLineMode)
+    return;
+  m_longLineMode = longLines;
+  // wrapping would have every edit break the whole line into rows again
+  setLineWrapMode(longLines ? NoWrap : WidgetWidth);
+  m_longLineFirst = m_longLineLast = 0;
+  m_longLineTop = -1;
+  if (!longLines && !m_longLineSelections.isEmpty()) {
+    m_longLineSelections.clear();
+    highlightCurrentLine();
+  }
+  updateLongLineWindow();
+}
+
+// moves the highlighted window of the long lines along once the visible
+// columns leave it, it reaches a screen width to either side of them; its
+// tokens are drawn as extra selections, formatting the block instead would
+// have the document report a change of the whole line
+void SourceCodeEditor::updateLongLineWindow() {
+  if (!m_longLineMode || !m_highlighter)
+    return;
+  const qreal columnWidth = fontMetrics().horizontalAdvance(' ');
+  const int first = int(horizontalScrollBar()->value() / columnWidth),
+            visible = int(viewport()->width() / columnWidth) + 1;
+  const int bottom = viewport()->rect().bottom();
+  QTextBlock last = firstVisibleBlock();
+  for (QTextBlock next = last.next();
+       next.isValid() &&
+       blockBoundingGeometry(next).translated(contentOffset()).top() <= bottom;
+       next = next.next())
+    last = next;
+  if (first >= m_longLineFirst && first + visible <= m_longLineLast &&
+      firstVisibleBlock().blockNumber() == m_longLineTop &&
+      last.blockNumber() == m_longLineBottom)
+    return;
+  if (first < m_longLineFirst || first + visible > m_longLineLast) {
+    m_longLineFirst = std::max(0, first - visible);
+    m_longLineLast = first + 2 * visible;
+  }
+  m_longLineTop = firstVisibleBlock().blockNumber();
+  m_longLineBottom = last.blockNumber();
+
+  // only the window is copied out of the line, not the whole of it
+  m_longLineSelections.clear();
+  for (QTextBlock block = firstVisibleBlock(); block.isValid();
+       block = block.next()) {
+    if (block.length() > CppSyntaxHightlighter::longLineThreshold) {
+      const int lineLength = block.length() - 1,
+                from = std::min(m_longLineFirst, lineLength),
+                to = std::min(m_longLineLast, lineLength);
+      QTextCursor window(document());
+      window.setPosition(block.position() + from);
+      window.setPosition(block.position() + to, QTextCursor::KeepAnchor);
+      for (const Token &t : m_highlighter->lexWindow(window.selectedText())) {
+        QTextEdit::ExtraSelection selection;
+        selection.format = m_highlighter->tokenFormat(t.tokenClass);
+        selection.cursor = QTextCursor(document());
+        selection.cursor.setPosition(block.position() + from + t.start);
+        selection.cursor.setPosition(block.position() + from + t.start +
+                                         t.length,
+                                     QTextCursor::KeepAnchor);
+        m_longLineSelections.append(selection);
+      }
+    }
+    if (block == last)
+      break;
+  }
+  highlightCurrentLine();
 }
 
 // heighlight the current aline
 void SourceCodeEditor::highlightCurrentLine() {
-  QList<QTextEdit::ExtraSelection> extraSelections;
+  QList<QTextEdit::ExtraSelection> extraSelections =
+      m_longLineSelections + m_semanticSelections;
 
-  if (!isReadOnly()) {
+  // a full width selection has a long line repainted on every cursor move
+  if (!isReadOnly() && textCursor().block().length() <=
+                           CppSyntaxHightlighter::longLineThreshold) {
     QTextEdit::ExtraSelection selection;
 
     auto lineColor = QColor("#E3F2FD").darker();
@@ -161,9 +479,47 @@ void SourceCodeEditor::highlightCurrentLine() {
     extraSelections.append(selection);
   }
 
+  // only the matches on screen, the rest are highlighted when scrolled to
+  if (m_textSearch && m_textSearch->isActive()) {
+    QTextEdit::ExtraSelection selection;
+    selection.format.setBackground(QColor("#FFB300").darker());
+    selection.cursor = QTextCursor(document());
+
+    const int bottom = viewport()->rect().bottom();
+    for (QTextBlock block = firstVisibleBlock();
+         block.isValid() &&
+         blockBoundingGeometry(block).translated(contentOffset()).top() <=
+             bottom;
+         block = block.next()) {
+      for (const auto &match : m_textSearch->matches(block)) {
+        selection.cursor.setPosition(match.position);
+        selection.cursor.setPosition(match.position + match.length,
+                                     QTextCursor::KeepAnchor);
+        extraSelections.append(selection);
+      }
+    }
+  }
+
   setExtraSelections(extraSelections);
 }
 
+void SourceCodeEditor::setTextSearch(TextSearch *search) {
+  m_textSearch = search;
+  connect(search, &TextSearch::queryChanged, this,
+          &SourceCodeEditor::highlightCurrentLine);
+  // the visible matches change with scrolling and editing
+  connect(verticalScrollBar(), &QScrollBar::valueChanged, this,
+          &SourceCodeEditor::highlightCurrentLine);
+  connect(this, &SourceCodeEditor::textChanged, this,
+          &SourceCodeEditor::highlightCurrentLine);
+}
+
+void SourceCodeEditor::setBufferDiff(BufferDiff *diff) {
+  m_bufferDiff = diff;
+  connect(diff, &BufferDiff::changed, lineNumberArea,
+          [this]() { lineNumberArea->update(); });
+}
+
 void SourceCodeEditor::lineNumberAreaPaintEvent(QPaintEvent *event) {
   QPainter painter(lineNumberArea);
   painter.fillRect(event->rect(), Qt::lightGray);
@@ -173,40 +529,238 @@ void SourceCodeEditor::lineNumberAreaPaintEvent(QPaintEvent *event) {
   QTextBlock block = firstVisibleBlock();
   int blockNumber = block.blockNumber();
   int top = (int)blockBoundingGeometry(block).translated(contentOffset()).top();
-  int bottom = top + (int)blockBoundingRect(block).height();
+  // unwrapped blocks are one row each, so the long ones below the last
+  // visible block are not laid out just to learn their height
+  const int rowHeight =
+      m_longLineMode ? (int)blockBoundingRect(block).height() : 0;
+  auto blockHeight = [this, rowHeight](const QTextBlock &b) {
+    return rowHeight ? rowHeight : (int)blockBoundingRect(b).height();
+  };
+  int bottom = top + blockHeight(block);
   while (block.isValid() && top <= event->rect().bottom()) {
     if (block.isVisible() && bottom >= event->rect().top()) {
+      if (m_lineProfile && m_lineProfile->count(blockNumber + 1) >= 0) {
+        // pale blue for lines that never ran, yellow to red for hot ones
+        const double heat = m_lineProfile->heat(blockNumber + 1);
+        const QColor color =
+            m_lineProfile->count(blockNumber + 1)
+                ? QColor::fromHsvF((1 - heat) / 6, 0.3 + 0.7 * heat, 1)
+                : QColor("#BBDEFB");
+        painter.fillRect(0, top, lineNumberArea->width(), bottom - top, color);
+      }
       QString number = QString::number(blockNumber + 1);
       painter.setPen(QColor("violet").darker());
       painter.setFont(font());
       painter.drawText(0, top, lineNumberArea->width() - 3,
                        fontMetrics().height(), Qt::AlignRight, number);
+      // a bar left of the number, removed lines a wedge where they were
+      switch (m_bufferDiff ? m_bufferDiff->mark(blockNumber)
+                           : BufferDiff::Unchanged) {
+      case BufferDiff::Added:
+        painter.fillRect(0, top, 3, bottom - top, QColor("#43A047"));
+        break;
+      case BufferDiff::Modified:
+        painter.fillRect(0, top, 3, bottom - top, QColor("#1E88E5"));
+        break;
+      case BufferDiff::RemovedAbove:
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(QColor("#E53935"));
+        painter.drawPolygon(QPolygon({{0, top - 3}, {5, top}, {0, top + 3}}));
+        break;
+      case BufferDiff::Unchanged:
+        break;
+      }
     }
 
     block = block.next();
     top = bottom;
-    bottom = top + (int)blockBoundingRect(block).height();
+    bottom = top + blockHeight(block);
     ++blockNumber;
   }
 }
 
 int SourceCodeEditor::loadFile(const QString &fileName) {
+  TraceSpan span("load");
   QFile file(fileName);
   if (!file.open(QFile::ReadOnly))
     return 1;
 
-  document()->setPlainText(file.readAll());
+  const QByteArray contents = file.readAll();
+  QVector<BlockSnapshot> cached;
+  const bool restored =
+      m_highlighter && FileCache::read(fileName, contents, cached);
+  if (restored)
+    m_highlighter->restore(std::move(cached));
+
+  TextEncoding encoding;
+  document()->setPlainText(TextEncoding::decode(contents, &encoding));
+  m_encoding = encoding;
+  updateLongLineMode();
+  if (m_undoHistory)
+    m_undoHistory->reset();
+
+  if (restored) {
+    // only the visible blocks are lexed again, to check the cache is sane
+    const int visibleBlocks =
+        viewport()->height() / fontMetrics().height() + 1;
+    if (!m_highlighter->verifyRestored(firstVisibleBlock(), visibleBlocks))
+      qDebug() << "Discarded stale cache of" << fileName;
+  } else if (m_highlighter) {
+    writeCache(fileName, contents);
+  }
+  watchFile(fileName, contents);
+  emit fileSynced(fileName);
   return 0;
 }
 
+void SourceCodeEditor::writeCache(const QString &fileName,
+                                  const QByteArray &contents) {
+  m_cacheWrite.waitForFinished();
+  m_cacheWrite = QtConcurrent::run(
+      [fileName, contents, blocks = m_highlighter->snapshot()]() {
+        return FileCache::write(fileName, contents, blocks);
+      });
+}
+
 int SourceCodeEditor::saveFile(const QString &fileName) {
+  TraceSpan span("save");
+  const QString text = document()->toPlainText();
+  if (!m_encoding.canEncode(text)) {
+    // typed or pasted characters the file's encoding has no bytes for
+    if (QMessageBox::question(
+            this, tr("Save as UTF-8"),
+            tr("%1 cannot store some of the characters as %2. Save it as "
+               "UTF-8 instead?")
+                .arg(QFileInfo(fileName).fileName(), m_encoding.name()),
+            QMessageBox::Yes | QMessageBox::No,
+            QMessageBox::Yes) != QMessageBox::Yes)
+      return 1;
+    m_encoding.codec = TextEncoding::Utf8;
+    m_encoding.bom = false;
+  }
   QFile file(fileName);
   if (!file.open(QFile::WriteOnly))
     return 1;
-  file.write(document()->toPlainText().toUtf8());
+  const QByteArray contents = m_encoding.encode(text);
+  file.write(contents);
+  file.close();
+  if (m_highlighter)
+    writeCache(fileName, contents);
+  document()->setModified(false);
+  watchFile(fileName, contents);
+  emit fileSynced(fileName);
   return 0;
 }
 
+qint64 SourceCodeEditor::compilerMsgsMemoryUsage() const {
+  qint64 bytes = m_compilerMsgs.capacity() * qint64(sizeof(CompilerMsgs));
+  for (const auto &msg : m_compilerMsgs)
+    bytes += msg.message.capacity() * qint64(sizeof(QChar));
+  return bytes;
+}
+
+void SourceCodeEditor::watchFile(const QString &fileName,
+                                 const QByteArray &contents) {
+  m_fileName = fileName;
+  m_syncedDigest = QCryptographicHash::hash(contents, QCryptographicHash::Md5);
+  if (!m_fileWatcher.files().isEmpty())
+    m_fileWatcher.removePaths(m_fileWatcher.files());
+  m_fileWatcher.addPath(fileName);
+}
+
+// unsaved changes are only ever replaced by the file if the user says so
+void SourceCodeEditor::fileChangedOnDisk() {
+  QFile file(m_fileName);
+  if (m_askingToReload || !file.open(QFile::ReadOnly))
+    return;
+  const QByteArray digest =
+      QCryptographicHash::hash(file.readAll(), QCryptographicHash::Md5);
+  if (digest == m_syncedDigest)
+    return; // e.g. our own save
+  if (document()->isModified()) {
+    m_askingToReload = true;
+    const auto answer = QMessageBox::question(
+        this, tr("File Changed on Disk"),
+        tr("%1 was changed by another program. Reload it and discard "
+           "your unsaved changes?")
+            .arg(QFileInfo(m_fileName).fileName()),
+        QMessageBox::Yes | QMessageBox::No, QMessageBox::No);
+    m_askingToReload = false;
+    if (answer != QMessageBox::Yes) {
+      m_syncedDigest = digest; // asked once per version of the file
+      return;
+    }
+  }
+  reloadFile();
+}
+
+int SourceCodeEditor::reloadFile() {
+  TraceSpan span("load");
+  QFile file(m_fileName);
+  if (m_fileName.isEmpty() || !file.open(QFile::ReadOnly))
+    return 1;
+  const QByteArray contents = file.readAll();
+  m_syncedDigest = QCryptographicHash::hash(contents, QCryptographicHash::Md5);
+  const QStringList newLines =
+      TextEncoding::decode(contents, &m_encoding).split('\n');
+  QStringList oldLines;
+  for (auto block = document()->firstBlock(); block.isValid();
+       block = block.next())
+    oldLines << block.text();
+  const auto hunks = LineDiff::compute(oldLines, newLines);
+  document()->setModified(false);
+  if (hunks.isEmpty())
+    return 0; // e.g. our own save
+
+  // back to front, so the blocks of the remaining hunks keep their numbers
+  const int scroll = verticalScrollBar()->value();
+  QTextCursor cursor(document());
+  cursor.beginEditBlock();
+  for (auto hunk = hunks.crbegin(); hunk != hunks.crend(); ++hunk) {
+    const QString text =
+        newLines.mid(hunk->newStart, hunk->newCount).join('\n');
+    if (hunk->oldStart + hunk->oldCount < oldLines.size()) {
+      // whole lines, each with its line break
+      cursor.setPosition(
+          document()->findBlockByNumber(hunk->oldStart).position());
+      cursor.setPosition(
+          document()
+              ->findBlockByNumber(hunk->oldStart + hunk->oldCount)
+              .position(),
+          QTextCursor::KeepAnchor);
+      cursor.insertText(hunk->newCount ? text + '\n' : QString());
+    } else {
+      // up to the end, which has no line break, so the one before goes
+      const QTextBlock before =
+          document()->findBlockByNumber(hunk->oldStart - 1);
+      cursor.setPosition(
+          before.isValid() ? before.position() + before.length() - 1 : 0);
+      cursor.movePosition(QTextCursor::End, QTextCursor::KeepAnchor);
+      cursor.insertText(!hunk->newCount      ? QString()
+                        : before.isValid() ? '\n' + text
+                                           : text);
+    }
+  }
+  cursor.endEditBlock();
+  document()->setModified(false);
+  verticalScrollBar()->setValue(scroll);
+  if (m_undoHistory)
+    m_undoHistory->breakTyping();
+  return 0;
+}
+
+void SourceCodeEditor::goToLine(int line, int column) {
+  const QTextBlock block = document()->findBlockByNumber(line - 1);
+  if (!block.isValid())
+    return;
+  QTextCursor cursor(block);
+  cursor.movePosition(QTextCursor::Right, QTextCursor::MoveAnchor,
+                      qBound(0, column - 1, block.length() - 1));
+  setTextCursor(cursor);
+  centerCursor();
+  setFocus();
+}
+
 void SourceCodeEditor::moveTextCursor(QTextCursor::MoveOperation operation,
                                       QTextCursor::MoveMode mode, int n) {
   auto tCursor = textCursor();
@@ -215,6 +769,7 @@ void SourceCodeEditor::moveTextCursor(QTextCursor::MoveOperation operation,
 }
 
 void SourceCodeEditor::keyPressEvent(QKeyEvent *e) {
+  TraceSpan span("key");
   const auto keyTxt = e->text();
   if (c && c->popup()->isVisible()) {
     // The following keys are forwarded by the completer to the widget
@@ -231,38 +786,69 @@ void SourceCodeEditor::keyPressEvent(QKeyEvent *e) {
     }
   }
 
+  if (m_undoHistory && (e->matches(QKeySequence::Undo) ||
+                        e->matches(QKeySequence::Redo))) {
+    undoOrRedo(e->matches(QKeySequence::Undo));
+    return;
+  }
+
   bool isShortcut = ((e->modifiers() & Qt::ControlModifier) &&
                      e->key() == Qt::Key_E); // CTRL+E
   if ((!c || !isShortcut) &&
-      (c && !c->popup()->isVisible())) { // do not process the shortcut
+      !(c && c->popup()->isVisible())) { // do not process the shortcut
                                          // when we have a completer
     static std::stack<QChar> keysToEat;
-    if (keyTxt == "\n" || keyTxt == "\r") {
-      insertPlainText(e->text() + QString(calculateTabLen(toPlainText().left(
-                                              textCursor().position())),
-                                          '\t'));
-      return;
-    }
-    for (const auto &c : m_CharsToComplete) {
-      if (c.first == keyTxt) {
-        insertPlainText(e->text() + c.second);
-        moveTextCursor(QTextCursor::PreviousCharacter);
-        keysToEat.push(c.second);
-        return;
+    auto insertKey = [&]() -> bool {
+      if (keyTxt == "\n" || keyTxt == "\r") {
+        insertPlainText(e->text() + QString(calculateTabLen(toPlainText().left(
+                                                textCursor().position())),
+                                            '\t'));
+        return false;
+      }
+      for (const auto &c : m_CharsToComplete) {
+        if (c.first == keyTxt) {
+          insertPlainText(e->text() + c.second);
+          moveTextCursor(QTextCursor::PreviousCharacter);
+          keysToEat.push(c.second);
+          return false;
+        }
+      }
+      if (!keysToEat.empty() && keysToEat.top() == keyTxt) {
+        moveTextCursor(QTextCursor::NextCharacter);
+        keysToEat.pop();
+        return false;
       }
+
+      QPlainTextEdit::keyPressEvent(e);
+      return true;
+    };
+
+    // typed text, auto pairs and indentation join the previous undo step
+    // until a word or line is complete
+    const bool typing = m_undoHistory && !keyTxt.isEmpty() &&
+                        (keyTxt[0].isPrint() || keyTxt == "\r" ||
+                         keyTxt == "\n" || keyTxt == "\t");
+    QTextCursor undoStep = textCursor();
+    if (typing) {
+      if (m_undoHistory->continuesTyping(undoStep.position()))
+        undoStep.joinPreviousEditBlock();
+      else
+        undoStep.beginEditBlock();
     }
-    if (!keysToEat.empty() && keysToEat.top() == keyTxt) {
-      moveTextCursor(QTextCursor::NextCharacter);
-      keysToEat.pop();
-      return;
+    const bool inserted = insertKey();
+    if (typing) {
+      undoStep.endEditBlock();
+      m_undoHistory->typed(textCursor().position(), keyTxt);
+    } else if (m_undoHistory) {
+      m_undoHistory->breakTyping();
     }
-
-    QPlainTextEdit::keyPressEvent(e);
+    if (!inserted)
+      return;
   }
 
   const bool ctrlOrShift =
       e->modifiers() & (Qt::ControlModifier | Qt::ShiftModifier);
-  if (!c || (ctrlOrShift && e->text().isEmpty()))
+  if (!c || !m_completionEngine || (ctrlOrShift && e->text().isEmpty()))
     return;
 
   static QString eow("~!@#$%^&*()_+{}|:\"<>?,./;'[]\\-="); // end of word
@@ -272,18 +858,33 @@ void SourceCodeEditor::keyPressEvent(QKeyEvent *e) {
   if (!isShortcut &&
       (hasModifier || e->text().isEmpty() || completionPrefix.length() < 3 ||
        eow.contains(e->text().right(1)))) {
+    m_completionEngine->cancel();
+    m_completionPrefix.clear();
+    m_completionPopupWidth = 0;
     c->popup()->hide();
     return;
   }
 
-  if (completionPrefix != c->completionPrefix()) {
-    c->setCompletionPrefix(completionPrefix);
-    c->popup()->setCurrentIndex(c->completionModel()->index(0, 0));
+  if (completionPrefix != m_completionPrefix) {
+    // the popup is updated once the engine has ranked the new prefix
+    m_completionPrefix = completionPrefix;
+    m_completionEngine->complete(completionPrefix, textCursor().block());
+    if (m_languageClient)
+      m_languageClient->requestCompletion(textCursor().position(),
+                                          completionPrefix);
+  } else if (!c->popup()->isVisible()) {
+    showCompletions(completionPrefix, m_completionEngine->model()->rowCount());
   }
-  QRect cr = cursorRect();
-  cr.setWidth(c->popup()->sizeHintForColumn(0) +
-              c->popup()->verticalScrollBar()->sizeHint().width());
-  c->complete(cr); // popup it up!
+}
+
+void SourceCodeEditor::insertFromMimeData(const QMimeData *source) {
+  // a paste is a single undo step of its own
+  QTextCursor undoStep = textCursor();
+  undoStep.beginEditBlock();
+  QPlainTextEdit::insertFromMimeData(source);
+  undoStep.endEditBlock();
+  if (m_undoHistory)
+    m_undoHistory->breakTyping();
 }
 
 bool SourceCodeEditor::event(QEvent *event) {
@@ -304,6 +905,34 @@ bool SourceCodeEditor::event(QEvent *event) {
         return true;
       }
     }
+    const qint64 runs = m_lineProfile ? m_lineProfile->count(cursorLineNo) : -1;
+    if (runs >= 0) {
+      QToolTip::showText(helpEvent->globalPos(),
+                         tr("Line %1 ran %2 times (hottest %3)")
+                             .arg(cursorLineNo)
+                             .arg(runs)
+                             .arg(m_lineProfile->maxCount()),
+                         this);
+      return true;
+    }
+    if (m_languageClient && m_languageClient->isReady()) {
+      // the hover replaces the tip below once the server answers
+      m_hoverPosition = cursor.position();
+      m_hoverGlobalPos = helpEvent->globalPos();
+      m_languageClient->requestHover(m_hoverPosition);
+    }
+    if (m_symbolIndex) {
+      cursor.select(QTextCursor::WordUnderCursor);
+      QStringList signatures;
+      for (const auto &symbol : m_symbolIndex->find(cursor.selectedText()))
+        signatures << QString("%1: %2").arg(SymbolIndex::kindName(symbol.kind),
+                                            symbol.signature);
+      if (!signatures.isEmpty()) {
+        QToolTip::showText(helpEvent->globalPos(), signatures.join('\n'),
+                           this);
+        return true;
+      }
+    }
     QToolTip::hideText();
     event->setAccepted(true);
     return true;
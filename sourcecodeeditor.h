@@ -1,11 +1,25 @@
 #ifndef SOURCECODEEDITOR_H
 #define SOURCECODEEDITOR_H
 
+#include "textencoding.h"
 #include <QCompleter>
 #include <QDebug>
+#include <QFileSystemWatcher>
+#include <QFuture>
 #include <QPlainTextEdit>
+#include <QTimer>
+#include <memory>
 #include <vector>
 
+class BufferDiff;
+class CompletionEngine;
+class CppSyntaxHightlighter;
+class LanguageClient;
+class LineProfile;
+class SymbolIndex;
+class TextSearch;
+class UndoHistory;
+
 struct CompilerMsgs {
   long int lineNo, columnNo;
   QString message;
@@ -16,10 +30,31 @@ class SourceCodeEditor : public QPlainTextEdit {
   Q_OBJECT
 public:
   SourceCodeEditor(QWidget *paren = nullptr);
+  // waits for the cache still being written
+  ~SourceCodeEditor() override;
 
   // 0: means successfull else signifies error
   int loadFile(const QString &fileName);
   int saveFile(const QString &fileName);
+  // applies only the lines of fileName() that changed on disk, keeping the
+  // cursor, the scroll position, the undo history and the highlighting of
+  // the rest; done on its own when another program rewrites the file, after
+  // asking if the document has unsaved changes
+  int reloadFile();
+  // the file last loaded or saved, empty for a new buffer
+  QString fileName() const { return m_fileName; }
+  // how fileName() is stored, it is written back the same way
+  TextEncoding encoding() const { return m_encoding; }
+  // moves the cursor to line and column, both 1 based
+  void goToLine(int line, int column = 1);
+  // on while a line is longer than the highlighter's long line threshold:
+  // lines are not wrapped and per keystroke work on long lines is bounded
+  bool longLineMode() const { return m_longLineMode; }
+
+  // highlighter of document(), its state is cached along with the files
+  void setHighlighter(CppSyntaxHightlighter *highlighter);
+  // undo history of document(), undo and redo keys go through it
+  void setUndoHistory(UndoHistory *history);
 
   void setTabSize(const int tabStop);
   void lineNumberAreaPaintEvent(QPaintEvent *event);
@@ -27,26 +62,61 @@ public:
 
   template <typename Parser> void setCompilerMsgs(Parser parser) {
     parser(m_compilerMsgs);
+    emit compilerMsgsChanged();
     qDebug() << QString("Parsing Completed got %1 results")
                     .arg(m_compilerMsgs.size());
   }
 
+  const std::vector<CompilerMsgs> &compilerMsgs() const {
+    return m_compilerMsgs;
+  }
+  // estimated bytes held by the parsed compiler messages
+  qint64 compilerMsgsMemoryUsage() const;
+  void squeezeCompilerMsgs() { m_compilerMsgs.shrink_to_fit(); }
+
   std::vector<std::pair<QChar, QChar>> CharsToComplete() const;
   void setCharsToComplete(
       const std::vector<std::pair<QChar, QChar>> &CharsToComplete);
   void setCompleter(QCompleter *c);
   QCompleter *completer() const;
+  // completer's popup shows the ranked candidates of engine
+  void setCompletionEngine(CompletionEngine *engine);
+  // signatures of the symbols shown as tool tips
+  void setSymbolIndex(std::shared_ptr<const SymbolIndex> symbols);
+  // matches of search in the visible part of the document are highlighted
+  void setTextSearch(TextSearch *search);
+  // lines added, modified or removed against the diff's base are marked in
+  // the line number area
+  void setBufferDiff(BufferDiff *diff);
+  // completions, hovers and diagnostics also come from client, which colours
+  // the visible lines with its semantic tokens
+  void setLanguageClient(LanguageClient *client);
+  // execution counts of a run of the document's text as a heat gradient in
+  // the line number area, until the text changes
+  void setLineProfile(std::shared_ptr<const LineProfile> profile);
+  bool showsLineProfile() const { return m_lineProfile != nullptr; }
+
+signals:
+  // the document now matches fileName on disk, after loading or saving it
+  void fileSynced(const QString &fileName);
+  void compilerMsgsChanged();
+  void lineProfileChanged(bool shown);
 
 private slots:
   void updateLineNumberAreaWidth(int newBlockCount);
   void highlightCurrentLine();
   void updateLineNumberArea(const QRect &, int);
   void insertCompletion(const QString &completion);
+  void showCompletions(const QString &prefix, int count);
+  void updateLongLineWindow();
 
 protected:
   void keyPressEvent(QKeyEvent *e) override;
+  void insertFromMimeData(const QMimeData *source) override;
   bool event(QEvent *) override;
+  void contextMenuEvent(QContextMenuEvent *e) override;
 
+  void paintEvent(QPaintEvent *e) override;
   void focusInEvent(QFocusEvent *e) override;
   void resizeEvent(QResizeEvent *event) override;
 
@@ -59,7 +129,41 @@ private:
                       QTextCursor::MoveMode mode = QTextCursor::MoveAnchor,
                       int n = 1);
   QString textUnderCursor() const;
-  QCompleter *c;
+  // through the undo history
+  void undoOrRedo(bool undo);
+  QCompleter *c = nullptr;
+  CompletionEngine *m_completionEngine = nullptr;
+  QString m_completionPrefix;
+  int m_completionPopupWidth = 0; // grows while the popup stays open
+  std::shared_ptr<const SymbolIndex> m_symbolIndex;
+  CppSyntaxHightlighter *m_highlighter = nullptr;
+  UndoHistory *m_undoHistory = nullptr;
+  TextSearch *m_textSearch = nullptr;
+  BufferDiff *m_bufferDiff = nullptr;
+  LanguageClient *m_languageClient = nullptr;
+  std::shared_ptr<const LineProfile> m_lineProfile;
+  QList<QTextEdit::ExtraSelection> m_semanticSelections;
+  QTimer m_semanticTokensTimer; // asks once scrolling or typing pauses
+  int m_hoverPosition = -1;
+  QPoint m_hoverGlobalPos;
+  void requestSemanticTokens();
+  QString m_fileName;
+  TextEncoding m_encoding;
+  QFileSystemWatcher m_fileWatcher;
+  QByteArray m_syncedDigest; // of what fileName() last held on disk
+  bool m_askingToReload = false;
+  void watchFile(const QString &fileName, const QByteArray &contents);
+  // the highlighter's blocks are taken here, the file is written by a
+  // worker, one write at a time so that the latest one wins
+  QFuture<bool> m_cacheWrite;
+  void writeCache(const QString &fileName, const QByteArray &contents);
+  void fileChangedOnDisk();
+  bool m_longLineMode = false;
+  int m_longLineFirst = 0, m_longLineLast = 0; // highlighted columns
+  int m_longLineTop = -1, m_longLineBottom = -1; // blocks they are drawn on
+  // the tokens of the window, drawn over the long lines on screen
+  QList<QTextEdit::ExtraSelection> m_longLineSelections;
+  void updateLongLineMode();
 };
 
 #endif // SOURCECODEEDITOR_H
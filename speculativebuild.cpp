@@ -0,0 +1,164 @@
+#include "speculativebuild.h"
+#include "documentedits.h"
+#include <QDebug>
+#include <QFile>
+#include <QTextDocument>
+#ifdef Q_OS_UNIX
+#include <csignal>
+#include <unistd.h>
+#endif
+#ifdef Q_OS_WIN
+#include <windows.h>
+#endif
+
+namespace {
+#ifdef Q_OS_WIN
+const QString executableSuffix = ".exe";
+#else
+const QString executableSuffix;
+#endif
+
+// the build and the compiler passes it starts run niced, in a process group
+// of their own so that a cancel reaches all of them
+class BackgroundProcess : public QProcess {
+public:
+  BackgroundProcess() {
+#ifdef Q_OS_WIN
+    setCreateProcessArgumentsModifier(
+        [](QProcess::CreateProcessArguments *arguments) {
+          arguments->flags |= BELOW_NORMAL_PRIORITY_CLASS;
+        });
+#endif
+  }
+
+  void killAll() {
+#ifdef Q_OS_UNIX
+    if (processId() > 0)
+      ::kill(-pid_t(processId()), SIGKILL);
+#endif
+    kill();
+  }
+
+protected:
+  void setupChildProcess() override {
+#ifdef Q_OS_UNIX
+    ::setpgid(0, 0);
+    if (::nice(19) == -1)
+      return; // still builds, just at normal priority
+#endif
+  }
+};
+} // namespace
+
+SpeculativeBuild::SpeculativeBuild(QTextDocument *document, QObject *parent)
+    : QObject(parent), m_document{document} {
+  m_idle.setSingleShot(true);
+  m_idle.setInterval(800);
+  connect(&m_idle, &QTimer::timeout, this, &SpeculativeBuild::start);
+  connect(DocumentEdits::of(document), &DocumentEdits::edited, this,
+          &SpeculativeBuild::documentChanged);
+}
+
+SpeculativeBuild::~SpeculativeBuild() { cancel(); }
+
+void SpeculativeBuild::setCompiler(
+    const QString &program,
+    std::function<QStringList(const QString &)> makeArguments) {
+  cancel();
+  m_program = program;
+  m_makeArguments = std::move(makeArguments);
+  m_ready = false;
+  m_idle.start();
+}
+
+void SpeculativeBuild::setLastCheckPassed(bool passed) {
+  m_lastCheckPassed = passed;
+  if (passed && !m_ready)
+    m_idle.start();
+}
+
+void SpeculativeBuild::documentChanged() {
+  ++m_revision;
+  cancel();
+  m_idle.start();
+}
+
+void SpeculativeBuild::start() {
+  if (!m_lastCheckPassed || m_program.isEmpty() || !m_outputDir.isValid() ||
+      (m_ready && m_readyRevision == m_revision))
+    return;
+
+  // a new name for every build, a cancelled one may still be writing its own
+  const QString output = m_outputDir.filePath(QString("a%1").arg(++m_builds));
+  auto process = std::make_unique<BackgroundProcess>();
+  process->setProcessChannelMode(QProcess::MergedChannels);
+  connect(process.get(),
+          QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this,
+          &SpeculativeBuild::buildFinished);
+  process->start(m_program, m_makeArguments(output));
+  if (!process->waitForStarted()) {
+    qDebug() << "Failed to start a speculative build with" << m_program;
+    return;
+  }
+  process->write(m_document->toPlainText().toUtf8());
+  process->closeWriteChannel();
+  m_process = std::move(process);
+  m_buildRevision = m_revision;
+  m_readyExecutable = output + executableSuffix;
+  ++m_stats.started;
+  emit statsChanged();
+}
+
+void SpeculativeBuild::cancel() {
+  m_idle.stop();
+  if (!m_process)
+    return;
+  // the compiler passes die with their group, the driver is reaped later
+  auto process = static_cast<BackgroundProcess *>(m_process.release());
+  process->disconnect(this);
+  connect(process,
+          QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+          process, &QObject::deleteLater);
+  process->killAll();
+  ++m_stats.cancelled;
+  emit statsChanged();
+}
+
+void SpeculativeBuild::buildFinished(int exitCode,
+                                     QProcess::ExitStatus status) {
+  // finished is still being emitted by it
+  QProcess *process = m_process.release();
+  process->deleteLater();
+  if (status != QProcess::NormalExit || m_buildRevision != m_revision)
+    return;
+  // a pause in typing often leaves a half written statement behind, so a
+  // failed build here does not stop the next ones, only a failed check does
+  m_ready = exitCode == 0;
+  m_readyRevision = m_buildRevision;
+  m_readyOutput = QString::fromLocal8Bit(process->readAll());
+  if (!m_ready) {
+    ++m_stats.failed;
+    emit statsChanged();
+  }
+}
+
+bool SpeculativeBuild::take(const QString &executable,
+                            QString *compilerOutput) {
+  if (m_process && m_buildRevision == m_revision)
+    m_process->waitForFinished(-1); // already part way there
+  bool hit = m_ready && m_readyRevision == m_revision &&
+             QFile::exists(m_readyExecutable);
+  if (hit) {
+    const QString target = executable + executableSuffix;
+    QFile::remove(target);
+    hit = QFile::rename(m_readyExecutable, target) ||
+          QFile::copy(m_readyExecutable, target);
+    QFile::setPermissions(target, QFile::permissions(target) |
+                                      QFile::ExeOwner | QFile::ExeUser);
+    *compilerOutput = m_readyOutput;
+    m_ready = false; // it has been moved
+  }
+  ++(hit ? m_stats.hits : m_stats.misses);
+  emit statsChanged();
+  return hit;
+}
@@ -0,0 +1,63 @@
+#ifndef SPECULATIVEBUILD_H
+#define SPECULATIVEBUILD_H
+
+#include <QObject>
+#include <QProcess>
+#include <QTemporaryDir>
+#include <QTimer>
+#include <functional>
+#include <memory>
+
+class QTextDocument;
+
+// builds the document at low priority whenever typing pauses, so that a
+// compile and run of an unchanged document only has to start the program;
+// any edit cancels the build in flight
+class SpeculativeBuild : public QObject {
+  Q_OBJECT
+public:
+  struct Stats {
+    int started = 0, cancelled = 0, failed = 0;
+    int hits = 0, misses = 0; // of take()
+  };
+
+  explicit SpeculativeBuild(QTextDocument *document, QObject *parent = nullptr);
+  ~SpeculativeBuild() override;
+
+  // how to build, arguments gets the output file appended by makeArguments
+  void setCompiler(const QString &program,
+                   std::function<QStringList(const QString &)> makeArguments);
+  // builds are only started while the last check of the document passed,
+  // the check being a compile the user asked for
+  void setLastCheckPassed(bool passed);
+  void setIdleInterval(int ms) { m_idle.setInterval(ms); }
+
+  // moves the executable built from the current text to executable, waiting
+  // for a build of it still in flight; false on a miss
+  bool take(const QString &executable, QString *compilerOutput);
+
+  const Stats &stats() const { return m_stats; }
+
+signals:
+  void statsChanged();
+
+private:
+  QTextDocument *m_document;
+  QString m_program;
+  std::function<QStringList(const QString &)> m_makeArguments;
+  QTimer m_idle;
+  QTemporaryDir m_outputDir;
+  std::unique_ptr<QProcess> m_process;
+  quint64 m_revision = 0, m_buildRevision = 0, m_readyRevision = 0;
+  int m_builds = 0;
+  bool m_lastCheckPassed = true, m_ready = false;
+  QString m_readyExecutable, m_readyOutput;
+  Stats m_stats;
+
+  void documentChanged();
+  void start();
+  void cancel();
+  void buildFinished(int exitCode, QProcess::ExitStatus status);
+};
+
+#endif // SPECULATIVEBUILD_H
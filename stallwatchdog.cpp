@@ -0,0 +1,255 @@
+#include "stallwatchdog.h"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <QThread>
+#include <algorithm>
+#include <chrono>
+// where the frame pointer and program counter of an interrupted thread are
+// known, its stack is walked along the frame pointers
+#if (defined(Q_OS_LINUX) || defined(Q_OS_MACOS)) &&                           \
+    (defined(__x86_64__) || defined(__aarch64__))
+#define STALL_BACKTRACE
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <execinfo.h>
+#include <pthread.h>
+#ifdef Q_OS_MACOS
+#include <sys/ucontext.h>
+#else
+#include <ucontext.h>
+#endif
+#endif
+
+namespace {
+const int pingInterval = 50;        // ms from an answer to the next ping
+const int backtraceWait = 50;       // ms for the gui thread to take its own
+const qint64 maxLogSize = 1 << 20;  // bytes, the log is rotated beyond it
+const int maxSpanDepth = 16;
+
+// set while the watchdog runs, spans of other threads are not tracked
+std::atomic<Qt::HANDLE> guiThread{nullptr};
+// literals only, so a stale name read by the watchdog is still valid
+std::atomic<const char *> spanNames[maxSpanDepth];
+std::atomic<int> spanDepth{0};
+
+#ifdef STALL_BACKTRACE
+const int backtraceSignal = SIGUSR2;
+const int maxFrames = 64;
+void *frames[maxFrames];
+std::atomic<int> frameCount{-1};
+pthread_t guiPthread;
+std::uintptr_t stackLow, stackHigh; // of the gui thread
+
+void interrupted(void *context, std::uintptr_t *pc, std::uintptr_t *fp) {
+  auto uc = static_cast<ucontext_t *>(context);
+#if defined(Q_OS_MACOS) && defined(__x86_64__)
+  *pc = uc->uc_mcontext->__ss.__rip, *fp = uc->uc_mcontext->__ss.__rbp;
+#elif defined(Q_OS_MACOS)
+  *pc = uc->uc_mcontext->__ss.__pc, *fp = uc->uc_mcontext->__ss.__fp;
+#elif defined(__x86_64__)
+  *pc = std::uintptr_t(uc->uc_mcontext.gregs[REG_RIP]);
+  *fp = std::uintptr_t(uc->uc_mcontext.gregs[REG_RBP]);
+#else
+  *pc = uc->uc_mcontext.pc, *fp = uc->uc_mcontext.regs[29];
+#endif
+}
+
+// runs on the gui thread, interrupting it wherever it is stuck; glibc's
+// backtrace() may take the loader's lock, which the interrupted code could
+// hold, so the frame pointers are followed by hand, only within the stack.
+// Code built without frame pointers ends the walk early, or leaves a
+// bogus frame in it
+void takeBacktrace(int, siginfo_t *, void *context) {
+  const int savedErrno = errno;
+  std::uintptr_t pc, fp;
+  interrupted(context, &pc, &fp);
+  int count = 0;
+  frames[count++] = reinterpret_cast<void *>(pc);
+  while (count < maxFrames && fp >= stackLow &&
+         fp + 2 * sizeof(void *) <= stackHigh && fp % sizeof(void *) == 0) {
+    // the caller's frame pointer, then the return address into it
+    const auto *frame = reinterpret_cast<const std::uintptr_t *>(fp);
+    if (!frame[1])
+      break;
+    frames[count++] = reinterpret_cast<void *>(frame[1]);
+    if (frame[0] <= fp)
+      break; // callers are further up the stack
+    fp = frame[0];
+  }
+  frameCount.store(count);
+  errno = savedErrno;
+}
+
+void findGuiStack() {
+#ifdef Q_OS_MACOS
+  stackHigh = std::uintptr_t(pthread_get_stackaddr_np(guiPthread));
+  stackLow = stackHigh - pthread_get_stacksize_np(guiPthread);
+#else
+  pthread_attr_t attributes;
+  void *address = nullptr;
+  std::size_t size = 0;
+  if (pthread_getattr_np(guiPthread, &attributes) == 0) {
+    pthread_attr_getstack(&attributes, &address, &size);
+    pthread_attr_destroy(&attributes);
+  }
+  stackLow = std::uintptr_t(address);
+  stackHigh = stackLow + size;
+#endif
+}
+
+QStringList guiBacktrace() {
+  frameCount.store(-1);
+  if (pthread_kill(guiPthread, backtraceSignal) != 0)
+    return {};
+  for (int waited = 0; frameCount.load() < 0 && waited < backtraceWait;
+       ++waited)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  const int count = frameCount.load();
+  char **symbols = count > 0 ? backtrace_symbols(frames, count) : nullptr;
+  if (!symbols)
+    return {};
+  QStringList backtrace;
+  for (int i = 0; i < count; ++i)
+    backtrace << QString::fromLocal8Bit(symbols[i]);
+  std::free(symbols);
+  return backtrace;
+}
+#else
+// another thread's stack cannot be walked portably, only the spans are known
+QStringList guiBacktrace() { return {}; }
+#endif
+} // namespace
+
+TraceSpan::TraceSpan(const char *name) {
+  const Qt::HANDLE gui = guiThread.load(std::memory_order_relaxed);
+  m_open = gui && gui == QThread::currentThreadId();
+  if (!m_open)
+    return;
+  const int depth = spanDepth.load(std::memory_order_relaxed);
+  if (depth < maxSpanDepth)
+    spanNames[depth].store(name, std::memory_order_relaxed);
+  spanDepth.store(depth + 1, std::memory_order_release);
+}
+
+TraceSpan::~TraceSpan() {
+  if (m_open)
+    spanDepth.store(spanDepth.load(std::memory_order_relaxed) - 1,
+                    std::memory_order_release);
+}
+
+QString TraceSpan::current() {
+  const int depth =
+      std::min(spanDepth.load(std::memory_order_acquire), maxSpanDepth);
+  QStringList names;
+  for (int i = 0; i < depth; ++i)
+    names << QString::fromLatin1(spanNames[i].load(std::memory_order_relaxed));
+  return names.join(" > ");
+}
+
+StallWatchdog::StallWatchdog(QObject *parent) : QObject(parent) {}
+
+StallWatchdog::~StallWatchdog() { stop(); }
+
+QString StallWatchdog::logPath() {
+  return QDir(QStandardPaths::writableLocation(
+                  QStandardPaths::AppDataLocation))
+      .filePath("stalls.log");
+}
+
+void StallWatchdog::start() {
+  if (m_thread.joinable())
+    return;
+#ifdef STALL_BACKTRACE
+  guiPthread = pthread_self();
+  findGuiStack();
+  struct sigaction action = {};
+  action.sa_sigaction = takeBacktrace;
+  action.sa_flags = SA_RESTART | SA_SIGINFO;
+  sigemptyset(&action.sa_mask);
+  sigaction(backtraceSignal, &action, nullptr);
+#endif
+  guiThread.store(QThread::currentThreadId());
+  m_running = true;
+  m_thread = std::thread(&StallWatchdog::watch, this);
+}
+
+void StallWatchdog::stop() {
+  if (!m_thread.joinable())
+    return;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_running = false;
+  }
+  m_wake.notify_all();
+  m_thread.join();
+  guiThread.store(nullptr);
+}
+
+void StallWatchdog::answer(quint64 ping) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_answered = ping;
+  }
+  m_wake.notify_all();
+}
+
+// on the watchdog's thread
+void StallWatchdog::watch() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  for (quint64 ping = 1; m_running; ++ping) {
+    QElapsedTimer waited;
+    waited.start();
+    QMetaObject::invokeMethod(this, [this, ping]() { answer(ping); },
+                              Qt::QueuedConnection);
+    const auto answered = [this, ping]() {
+      return !m_running || m_answered == ping;
+    };
+    if (!m_wake.wait_for(lock, std::chrono::milliseconds(m_threshold.load()),
+                         answered)) {
+      // taken while the gui thread is still on the path that stalls it
+      lock.unlock();
+      Stall stall{QDateTime::currentDateTime().addMSecs(-waited.elapsed()), 0,
+                  TraceSpan::current(), guiBacktrace()};
+      lock.lock();
+      m_wake.wait(lock, answered);
+      if (!m_running)
+        break;
+      stall.milliseconds = waited.elapsed();
+      lock.unlock();
+      log(stall);
+      QMetaObject::invokeMethod(this,
+                                [this, stall]() {
+                                  ++m_stallCount;
+                                  emit stalled(stall);
+                                },
+                                Qt::QueuedConnection);
+      lock.lock();
+    }
+    m_wake.wait_for(lock, std::chrono::milliseconds(pingInterval),
+                    [this]() { return !m_running; });
+  }
+}
+
+void StallWatchdog::log(const Stall &stall) {
+  const QString path = logPath();
+  QDir().mkpath(QFileInfo(path).absolutePath());
+  if (QFileInfo(path).size() > maxLogSize) {
+    QFile::remove(path + ".1");
+    QFile::rename(path, path + ".1");
+  }
+  QFile file(path);
+  if (!file.open(QFile::Append | QFile::Text))
+    return;
+  QTextStream out(&file);
+  out << stall.when.toString(Qt::ISODateWithMs) << " stalled "
+      << stall.milliseconds << " ms in "
+      << (stall.spans.isEmpty() ? QString("no span") : stall.spans) << '\n';
+  for (const auto &frame : stall.backtrace)
+    out << "    " << frame << '\n';
+}
@@ -0,0 +1,75 @@
+#ifndef STALLWATCHDOG_H
+#define STALLWATCHDOG_H
+
+#include <QDateTime>
+#include <QObject>
+#include <QStringList>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// marks what the gui thread is busy with while it is in scope, so that a
+// stall can be blamed on it; spans nest, and cost a couple of atomic stores
+// while the watchdog runs and a load otherwise
+class TraceSpan {
+public:
+  // name has to outlive the span's use by the watchdog, a literal
+  explicit TraceSpan(const char *name);
+  ~TraceSpan();
+  TraceSpan(const TraceSpan &) = delete;
+  TraceSpan &operator=(const TraceSpan &) = delete;
+
+  // the spans open on the gui thread, outermost first: "paint > highlight"
+  static QString current();
+
+private:
+  bool m_open;
+};
+
+// pings the gui thread's event loop from a thread of its own; when a ping
+// goes unanswered for longer than the threshold the open trace spans and a
+// backtrace of the gui thread are taken, while it is still stuck, and the
+// stall is appended to a rotating log once it ends
+class StallWatchdog : public QObject {
+  Q_OBJECT
+public:
+  struct Stall {
+    QDateTime when;
+    qint64 milliseconds;
+    QString spans;
+    QStringList backtrace; // empty where it cannot be taken
+  };
+
+  // to be made on the gui thread
+  explicit StallWatchdog(QObject *parent = nullptr);
+  ~StallWatchdog() override;
+
+  int threshold() const { return m_threshold; }
+  void setThreshold(int milliseconds) { m_threshold = milliseconds; }
+  void start();
+  void stop();
+
+  // stalls of this session
+  int stallCount() const { return m_stallCount; }
+  static QString logPath();
+
+signals:
+  // on the gui thread, once it responds again
+  void stalled(const StallWatchdog::Stall &stall);
+
+private:
+  std::atomic<int> m_threshold{100}; // ms
+  int m_stallCount = 0;
+  std::thread m_thread;
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  bool m_running = false;
+  quint64 m_answered = 0; // the last ping the gui thread answered
+
+  void watch();
+  void answer(quint64 ping);
+  static void log(const Stall &stall);
+};
+
+#endif // STALLWATCHDOG_H
@@ -0,0 +1,30 @@
+#include "startupprofile.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QEvent>
+#include <QTimer>
+
+StartupProfile::StartupProfile(QElapsedTimer sinceStart,
+                               std::function<void()> onInteractive,
+                               QObject *parent)
+    : QObject(parent), m_sinceStart{sinceStart},
+      m_onInteractive{std::move(onInteractive)} {
+  QCoreApplication::instance()->installEventFilter(this);
+}
+
+bool StartupProfile::eventFilter(QObject *, QEvent *event) {
+  if (event->type() != QEvent::Paint || m_firstPaint >= 0)
+    return false;
+
+  m_firstPaint = m_sinceStart.elapsed();
+  QCoreApplication::instance()->removeEventFilter(this);
+  // runs once the events queued up to the first frame are processed
+  QTimer::singleShot(0, this, [this]() {
+    m_interactive = m_sinceStart.elapsed();
+    qInfo() << "Startup: first paint" << m_firstPaint << "ms, interactive"
+            << m_interactive << "ms";
+    if (m_onInteractive)
+      m_onInteractive();
+  });
+  return false;
+}
@@ -0,0 +1,29 @@
+#ifndef STARTUPPROFILE_H
+#define STARTUPPROFILE_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <functional>
+
+// measures the time from process start to the first painted frame and to the
+// first time the event loop is idle afterwards, when onInteractive is run
+class StartupProfile : public QObject {
+public:
+  StartupProfile(QElapsedTimer sinceStart,
+                 std::function<void()> onInteractive,
+                 QObject *parent = nullptr);
+
+  // in milliseconds, -1 until reached
+  qint64 firstPaint() const { return m_firstPaint; }
+  qint64 interactive() const { return m_interactive; }
+
+protected:
+  bool eventFilter(QObject *, QEvent *event) override;
+
+private:
+  QElapsedTimer m_sinceStart;
+  std::function<void()> m_onInteractive;
+  qint64 m_firstPaint = -1, m_interactive = -1;
+};
+
+#endif // STARTUPPROFILE_H
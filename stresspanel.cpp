@@ -0,0 +1,128 @@
+#include "stresspanel.h"
+#include <QDir>
+#include <QFileDialog>
+#include <QHBoxLayout>
+#include <QThread>
+#include <limits>
+
+StressPanel::StressPanel(QWidget *parent)
+    : QWidget(parent), m_browseGenerator{"..."}, m_browseReference{"..."},
+      m_start{tr("Start")} {
+  m_generator.setPlaceholderText(tr("Generator source, prints an input for "
+                                    "the seed in argv[1]"));
+  m_reference.setPlaceholderText(tr("Reference source, a slow but sure "
+                                    "solution"));
+  m_comparison.addItems(
+      {tr("Exact"), tr("Ignore whitespace"), tr("Floats within 1e-6")});
+  m_comparison.setCurrentIndex(OutputComparator::Tokens);
+  m_jobs.setRange(1, 64);
+  m_jobs.setValue(QThread::idealThreadCount());
+  m_jobs.setPrefix(tr("Jobs: "));
+  m_timeLimit.setRange(100, 60000);
+  m_timeLimit.setSingleStep(500);
+  m_timeLimit.setValue(2000);
+  m_timeLimit.setSuffix(tr(" ms"));
+  m_firstSeed.setRange(0, std::numeric_limits<int>::max());
+  m_firstSeed.setValue(1);
+  m_firstSeed.setPrefix(tr("From seed: "));
+  m_failure.setTextInteractionFlags(Qt::TextSelectableByMouse);
+  m_failure.setWordWrap(true);
+
+  auto sources = new QHBoxLayout;
+  sources->addWidget(new QLabel(tr("Generator:")));
+  sources->addWidget(&m_generator, 1);
+  sources->addWidget(&m_browseGenerator);
+  sources->addWidget(new QLabel(tr("Reference:")));
+  sources->addWidget(&m_reference, 1);
+  sources->addWidget(&m_browseReference);
+  auto controls = new QHBoxLayout;
+  controls->addWidget(&m_comparison);
+  controls->addWidget(&m_jobs);
+  controls->addWidget(&m_timeLimit);
+  controls->addWidget(&m_firstSeed);
+  controls->addWidget(&m_start);
+  controls->addWidget(&m_status, 1);
+  m_layout.setContentsMargins(0, 0, 0, 0);
+  m_layout.addLayout(sources);
+  m_layout.addLayout(controls);
+  m_layout.addWidget(&m_failure);
+  m_layout.addStretch();
+  setLayout(&m_layout);
+
+  connect(&m_browseGenerator, &QPushButton::clicked,
+          [this]() { browse(&m_generator, tr("Generator Source")); });
+  connect(&m_browseReference, &QPushButton::clicked,
+          [this]() { browse(&m_reference, tr("Reference Source")); });
+  connect(&m_start, &QPushButton::clicked, [this]() {
+    if (m_tester.isRunning()) {
+      stop();
+      return;
+    }
+    m_failure.clear();
+    if (m_generator.text().isEmpty() || m_reference.text().isEmpty())
+      m_status.setText(tr("Choose a generator and a reference first"));
+    else
+      emit startRequested(m_generator.text(), m_reference.text());
+  });
+
+  connect(&m_tester, &StressTester::progress,
+          [this](qint64 seeds, double seedsPerSecond) {
+            m_status.setText(tr("%1 seeds passed, %2 seeds/s")
+                                 .arg(seeds)
+                                 .arg(seedsPerSecond, 0, 'f', 1));
+          });
+  connect(&m_tester, &StressTester::failed,
+          [this](const StressTester::Failure &failure) {
+            setRunning(false);
+            QString text = tr("Seed %1: %2 (%3)")
+                               .arg(failure.seed)
+                               .arg(StressTester::kindName(failure.kind))
+                               .arg(failure.detail);
+            if (!failure.inputPath.isEmpty())
+              text += "\n" + tr("Input saved to %1")
+                                 .arg(QDir::toNativeSeparators(
+                                     failure.inputPath));
+            if (!failure.expectedPath.isEmpty())
+              text += "\n" + tr("Reference output saved to %1")
+                                 .arg(QDir::toNativeSeparators(
+                                     failure.expectedPath));
+            m_failure.setText(text);
+          });
+  connect(&m_tester, &StressTester::finished,
+          [this]() { setRunning(false); });
+}
+
+void StressPanel::browse(QLineEdit *source, const QString &title) {
+  const QString fileName = QFileDialog::getOpenFileName(
+      this, title, QDir::currentPath(), tr("C Sources (*.c);;All Files(*)"));
+  if (!fileName.isEmpty())
+    source->setText(fileName);
+}
+
+void StressPanel::start(const QString &generator, const QString &solution,
+                        const QString &reference) {
+  m_tester.setJobs(m_jobs.value());
+  m_tester.setTimeLimit(m_timeLimit.value());
+  m_tester.setComparison(
+      static_cast<OutputComparator::Mode>(m_comparison.currentIndex()));
+  m_tester.setDirectory(QDir::currentPath());
+  m_status.setText(tr("Starting"));
+  m_failure.clear();
+  setRunning(true);
+  m_tester.start(generator, solution, reference, m_firstSeed.value());
+}
+
+void StressPanel::stop() {
+  m_tester.stop();
+  setRunning(false);
+}
+
+void StressPanel::setRunning(bool running) {
+  m_start.setText(running ? tr("Stop") : tr("Start"));
+  for (QWidget *control :
+       std::initializer_list<QWidget *>{&m_generator, &m_reference,
+                                        &m_browseGenerator, &m_browseReference,
+                                        &m_comparison, &m_jobs, &m_timeLimit,
+                                        &m_firstSeed})
+    control->setEnabled(!running);
+}
@@ -0,0 +1,43 @@
+#ifndef STRESSPANEL_H
+#define STRESSPANEL_H
+
+#include "stresstester.h"
+#include <QComboBox>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QSpinBox>
+#include <QVBoxLayout>
+#include <QWidget>
+
+// the built program checked against a reference solution on generated
+// inputs until they disagree, with the throughput and the first failure
+class StressPanel : public QWidget {
+  Q_OBJECT
+public:
+  explicit StressPanel(QWidget *parent = nullptr);
+
+  // runs the already built programs, seed after seed
+  void start(const QString &generator, const QString &solution,
+             const QString &reference);
+  void stop();
+
+signals:
+  // the sources of the generator and the reference are to be built
+  void startRequested(const QString &generatorSource,
+                      const QString &referenceSource);
+
+private:
+  StressTester m_tester;
+  QVBoxLayout m_layout;
+  QLineEdit m_generator, m_reference;
+  QPushButton m_browseGenerator, m_browseReference, m_start;
+  QComboBox m_comparison;
+  QSpinBox m_jobs, m_timeLimit, m_firstSeed;
+  QLabel m_status, m_failure;
+
+  void browse(QLineEdit *source, const QString &title);
+  void setRunning(bool running);
+};
+
+#endif // STRESSPANEL_H
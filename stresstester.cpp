@@ -0,0 +1,220 @@
+#include "stresstester.h"
+#include <QDir>
+#include <QFile>
+#include <QThread>
+
+namespace {
+const int watchInterval = 10;     // ms
+const int progressInterval = 250; // ms
+
+bool save(const QString &path, const QByteArray &data) {
+  QFile file(path);
+  return file.open(QFile::WriteOnly) && file.write(data) == data.size();
+}
+} // namespace
+
+StressTester::StressTester(QObject *parent)
+    : QObject(parent), m_jobs{QThread::idealThreadCount()} {
+  m_watchdog.setInterval(watchInterval);
+  connect(&m_watchdog, &QTimer::timeout, this, &StressTester::watch);
+}
+
+StressTester::~StressTester() { stop(); }
+
+QString StressTester::kindName(FailureKind kind) {
+  switch (kind) {
+  case Mismatch:
+    return tr("Outputs differ");
+  case TimeLimit:
+    return tr("Time limit exceeded");
+  case Crash:
+    return tr("Runtime error");
+  case Failed:
+    break;
+  }
+  return tr("Failed to run");
+}
+
+void StressTester::start(const QString &generator, const QString &solution,
+                         const QString &reference, qint64 firstSeed) {
+  stop();
+  m_programs[Generator] = generator;
+  m_programs[Solution] = solution;
+  m_programs[Reference] = reference;
+  m_nextSeed = firstSeed;
+  m_lastSeed = m_maxSeeds > 0 ? firstSeed + m_maxSeeds : 0;
+  m_done = 0;
+  m_clock.start();
+  m_sinceProgress.start();
+  m_watchdog.start();
+  while (int(m_running.size()) < m_jobs &&
+         (!m_lastSeed || m_nextSeed < m_lastSeed))
+    startNext();
+}
+
+void StressTester::stop() {
+  m_lastSeed = m_nextSeed; // nothing more is started
+  m_watchdog.stop();
+  // a failure stops the run from a signal of one of the processes, so the
+  // jobs are deleted later, as in release()
+  while (!m_running.empty()) {
+    Job *job = m_running.back().get();
+    for (auto &process : job->processes) {
+      process.disconnect(this);
+      process.kill();
+      process.waitForFinished(100);
+    }
+    release(job);
+  }
+}
+
+void StressTester::startNext() {
+  m_running.push_back(std::make_unique<Job>());
+  Job *job = m_running.back().get();
+  job->seed = m_nextSeed++;
+  job->elapsed.start();
+  launch(job, Generator, {QString::number(job->seed)});
+}
+
+void StressTester::launch(Job *job, Program program,
+                          const QStringList &arguments) {
+  QProcess &process = job->processes[program];
+  process.setStandardErrorFile(QProcess::nullDevice());
+  connect(&process, &QProcess::readyReadStandardOutput, this,
+          [job, program]() {
+            job->outputs[program] +=
+                job->processes[program].readAllStandardOutput();
+          });
+  connect(&process,
+          QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this,
+          [this, job, program]() { processFinished(job, program); });
+  connect(&process, &QProcess::errorOccurred, this,
+          [this, job, program](QProcess::ProcessError error) {
+            if (error == QProcess::FailedToStart)
+              processFinished(job, program);
+          });
+  process.start(m_programs[program], arguments);
+}
+
+void StressTester::processFinished(Job *job, Program program) {
+  QProcess &process = job->processes[program];
+  job->outputs[program] += process.readAllStandardOutput();
+  if (program != Generator) {
+    if (--job->solving == 0)
+      judge(job);
+    return;
+  }
+
+  if (process.error() == QProcess::FailedToStart)
+    return fail(job, Failed, tr("generator: %1").arg(process.errorString()));
+  if (job->timedOut[Generator])
+    return fail(job, TimeLimit, tr("generator"));
+  if (process.exitStatus() == QProcess::CrashExit || process.exitCode() != 0)
+    return fail(job, Crash,
+                tr("generator, exit code %1").arg(process.exitCode()));
+
+  // both solvers get the input at once, the time limit holds for each
+  job->solving = 2;
+  job->elapsed.restart();
+  for (Program solver : {Solution, Reference}) {
+    launch(job, solver, {});
+    job->processes[solver].write(job->outputs[Generator]);
+    job->processes[solver].closeWriteChannel();
+  }
+}
+
+void StressTester::judge(Job *job) {
+  // a broken reference leaves nothing to compare with, so it is reported
+  // first, and saved without an expected output
+  for (Program solver : {Reference, Solution}) {
+    const QProcess &process = job->processes[solver];
+    const QString name =
+        solver == Solution ? tr("solution") : tr("reference");
+    const Saved saved = solver == Solution ? InputAndExpected : Input;
+    if (process.error() == QProcess::FailedToStart)
+      return fail(job, Failed,
+                  QString("%1: %2").arg(name).arg(process.errorString()),
+                  saved);
+    if (job->timedOut[solver])
+      return fail(job, TimeLimit, name, saved);
+    if (process.exitStatus() == QProcess::CrashExit ||
+        process.exitCode() != 0)
+      return fail(job, Crash,
+                  tr("%1, exit code %2").arg(name).arg(process.exitCode()),
+                  saved);
+  }
+
+  OutputComparator comparator(job->outputs[Reference], m_mode, m_epsilon);
+  const bool same =
+      comparator.feed(job->outputs[Solution]) && comparator.finish();
+  if (!same)
+    return fail(job, Mismatch, comparator.mismatch(), InputAndExpected);
+
+  ++m_done;
+  release(job);
+  if (!m_lastSeed || m_nextSeed < m_lastSeed) {
+    startNext();
+  } else if (m_running.empty()) {
+    m_watchdog.stop();
+    reportProgress();
+    emit finished(m_done);
+  }
+}
+
+void StressTester::fail(Job *job, FailureKind kind, const QString &detail,
+                        Saved saved) {
+  Failure failure{kind, job->seed, detail, {}, {}};
+  const QDir directory(m_directory);
+  const QString name = QString("stress-%1").arg(job->seed);
+  if (saved != Nothing) {
+    failure.inputPath = directory.filePath(name + ".in");
+    if (!save(failure.inputPath, job->outputs[Generator]))
+      failure.inputPath.clear();
+  }
+  if (saved == InputAndExpected) {
+    failure.expectedPath = directory.filePath(name + ".ans");
+    if (!save(failure.expectedPath, job->outputs[Reference]))
+      failure.expectedPath.clear();
+  }
+  stop();
+  reportProgress();
+  emit failed(failure);
+}
+
+void StressTester::release(Job *job) {
+  // the processes may still be delivering a signal, so the job is deleted
+  // later
+  auto it = std::find_if(m_running.begin(), m_running.end(),
+                         [job](const auto &j) { return j.get() == job; });
+  if (it == m_running.end())
+    return;
+  it->release();
+  m_running.erase(it);
+  for (auto &process : job->processes)
+    process.disconnect(this);
+  QMetaObject::invokeMethod(this, [job]() { delete job; },
+                            Qt::QueuedConnection);
+}
+
+void StressTester::watch() {
+  for (auto &job : m_running) {
+    if (job->elapsed.elapsed() <= m_timeLimit)
+      continue;
+    for (int program = Generator; program <= Reference; ++program) {
+      QProcess &process = job->processes[program];
+      if (process.state() != QProcess::NotRunning &&
+          !job->timedOut[program]) {
+        job->timedOut[program] = true;
+        process.kill();
+      }
+    }
+  }
+  if (m_sinceProgress.elapsed() >= progressInterval)
+    reportProgress();
+}
+
+void StressTester::reportProgress() {
+  m_sinceProgress.restart();
+  emit progress(m_done,
+                m_done * 1000.0 / std::max<qint64>(m_clock.elapsed(), 1));
+}
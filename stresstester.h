@@ -0,0 +1,92 @@
+#ifndef STRESSTESTER_H
+#define STRESSTESTER_H
+
+#include "testrunner.h"
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QObject>
+#include <QProcess>
+#include <QTimer>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+// runs a generator with one seed after another and feeds each input it
+// prints to a solution and to a reference, on as many seeds at once as there
+// are jobs, until their outputs differ
+class StressTester : public QObject {
+  Q_OBJECT
+public:
+  enum FailureKind { Mismatch, TimeLimit, Crash, Failed };
+  struct Failure {
+    FailureKind kind;
+    qint64 seed;
+    QString detail;
+    // the failing input and what the reference made of it, saved as a test
+    // case the Tests tab discovers
+    QString inputPath, expectedPath;
+  };
+
+  explicit StressTester(QObject *parent = nullptr);
+  ~StressTester() override;
+
+  void setJobs(int jobs) { m_jobs = std::max(jobs, 1); }
+  void setTimeLimit(int milliseconds) { m_timeLimit = milliseconds; }
+  void setComparison(OutputComparator::Mode mode, double epsilon = 1e-6) {
+    m_mode = mode;
+    m_epsilon = epsilon;
+  }
+  // where the failing case is saved
+  void setDirectory(const QString &directory) { m_directory = directory; }
+  // seeds tried before giving up, 0 tries until stopped
+  void setMaxSeeds(qint64 maxSeeds) { m_maxSeeds = maxSeeds; }
+
+  // the generator gets its seed as its only argument
+  void start(const QString &generator, const QString &solution,
+             const QString &reference, qint64 firstSeed = 1);
+  void stop();
+  bool isRunning() const { return !m_running.empty(); }
+
+  static QString kindName(FailureKind kind);
+
+signals:
+  void progress(qint64 seeds, double seedsPerSecond);
+  void failed(const StressTester::Failure &failure);
+  // every seed up to the limit passed
+  void finished(qint64 seeds);
+
+private:
+  enum Program { Generator, Solution, Reference };
+  // what of a failing seed is worth keeping
+  enum Saved { Nothing, Input, InputAndExpected };
+  struct Job {
+    qint64 seed;
+    QProcess processes[3];
+    QByteArray outputs[3];
+    QElapsedTimer elapsed; // of the generator, then of both solvers
+    int solving = 0;       // solvers still running
+    bool timedOut[3] = {};
+  };
+
+  QString m_programs[3];
+  std::vector<std::unique_ptr<Job>> m_running;
+  qint64 m_nextSeed = 0, m_lastSeed = 0, m_done = 0, m_maxSeeds = 0;
+  int m_jobs, m_timeLimit = 2000;
+  OutputComparator::Mode m_mode = OutputComparator::Tokens;
+  double m_epsilon = 1e-6;
+  QString m_directory = ".";
+  QElapsedTimer m_clock, m_sinceProgress;
+  QTimer m_watchdog; // enforces the time limit and reports the throughput
+
+  void startNext();
+  void launch(Job *job, Program program, const QStringList &arguments);
+  void processFinished(Job *job, Program program);
+  void judge(Job *job);
+  void fail(Job *job, FailureKind kind, const QString &detail,
+            Saved saved = Nothing);
+  void release(Job *job);
+  void watch();
+  void reportProgress();
+};
+
+#endif // STRESSTESTER_H
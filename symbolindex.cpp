@@ -0,0 +1,462 @@
+#include "symbolindex.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QProcess>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QStringList>
+#include <algorithm>
+#include <cstring>
+
+struct SymbolIndex::Header {
+  char magic[4];
+  quint32 version;
+  quint32 count;
+  quint32 stringsOffset;
+};
+
+struct SymbolIndex::Entry {
+  quint32 nameOffset;
+  quint32 signatureOffset;
+  quint16 nameLength;
+  quint16 signatureLength;
+  quint8 kind;
+  quint8 reserved[3];
+};
+
+namespace {
+const char indexMagic[4] = {'Q', 'C', 'S', 'I'};
+const quint32 indexVersion = 1;
+
+const char *const indexedHeaders[] = {
+    "assert.h", "ctype.h",  "errno.h",  "float.h",  "limits.h",
+    "locale.h", "math.h",   "setjmp.h", "signal.h", "stdarg.h",
+    "stdbool.h", "stddef.h", "stdint.h", "stdio.h",  "stdlib.h",
+    "string.h", "time.h",   "wchar.h",  "wctype.h", "inttypes.h"};
+
+bool isIdentifier(const QString &token) {
+  return !token.isEmpty() && (token[0].isLetter() || token[0] == '_');
+}
+
+// implementation details of the c library, not worth suggesting
+bool isReserved(const QString &name) {
+  return name.startsWith("__") ||
+         (name.size() > 1 && name[0] == '_' && name[1].isUpper());
+}
+
+QString joinTokens(const QStringList &tokens) {
+  static const QString noSpaceBefore = ",)];([";
+  QString result;
+  for (const auto &t : tokens) {
+    if (!result.isEmpty() && !noSpaceBefore.contains(t) &&
+        !result.endsWith('(') && !result.endsWith('[') &&
+        !(result.endsWith('*') && t != "*"))
+      result += ' ';
+    result += t;
+  }
+  return result;
+}
+
+// name introduced by a declaration, printf in int printf(const char *, ...)
+QString declaratorName(const QStringList &tokens) {
+  int paren = tokens.indexOf("(");
+  if (paren > 0) {
+    if (paren + 2 < tokens.size() && tokens[paren + 1] == "*" &&
+        isIdentifier(tokens[paren + 2]))
+      return tokens[paren + 2];
+    return isIdentifier(tokens[paren - 1]) ? tokens[paren - 1] : QString();
+  }
+  int end = tokens.indexOf("[");
+  if (end < 0)
+    end = tokens.indexOf("=");
+  if (end < 0)
+    end = tokens.size();
+  for (int i = end - 1; i >= 0; --i)
+    if (isIdentifier(tokens[i]))
+      return tokens[i];
+  return {};
+}
+
+QStringList tokenize(const QString &text,
+                     QVector<SymbolIndex::Symbol> &macros) {
+  QStringList tokens;
+  bool atLineStart = true;
+  for (int i = 0, n = text.size(); i < n;) {
+    const QChar ch = text[i];
+    if (ch == '\n') {
+      atLineStart = true;
+      ++i;
+      continue;
+    }
+    if (ch.isSpace()) {
+      ++i;
+      continue;
+    }
+    if (ch == '#' && atLineStart) { // line markers and -dD's #defines
+      int end = text.indexOf('\n', i);
+      if (end < 0)
+        end = n;
+      const QString line = text.mid(i, end - i);
+      if (line.startsWith("#define ")) {
+        int nameEnd = 8;
+        while (nameEnd < line.size() &&
+               (line[nameEnd].isLetterOrNumber() || line[nameEnd] == '_'))
+          ++nameEnd;
+        const QString name = line.mid(8, nameEnd - 8);
+        if (!name.isEmpty() && !isReserved(name))
+          macros.push_back({SymbolIndex::Symbol::Macro, name,
+                            line.left(120).simplified()});
+      }
+      i = end;
+      continue;
+    }
+    atLineStart = false;
+
+    int end = i + 1;
+    if (ch.isLetterOrNumber() || ch == '_') {
+      while (end < n && (text[end].isLetterOrNumber() || text[end] == '_' ||
+                         (ch.isDigit() && text[end] == '.')))
+        ++end;
+    } else if (ch == '"' || ch == '\'') {
+      while (end < n && text[end] != ch && text[end] != '\n')
+        end += text[end] == '\\' ? 2 : 1;
+      ++end;
+    }
+    tokens << text.mid(i, end - i);
+    i = end;
+  }
+  return tokens;
+}
+
+QVector<SymbolIndex::Symbol> scanPreprocessed(const QString &text) {
+  using Symbol = SymbolIndex::Symbol;
+  QVector<Symbol> symbols;
+  const QStringList tokens = tokenize(text, symbols);
+
+  auto emitSymbol = [&symbols](Symbol::Kind kind, const QString &name,
+                               const QString &signature) {
+    if (!name.isEmpty() && !isReserved(name))
+      symbols.push_back({kind, name, signature});
+  };
+
+  auto emitDeclaration = [&emitSymbol](QStringList statement) {
+    statement.removeAll("extern");
+    if (statement.isEmpty() ||
+        (statement.contains("{}") && statement.first() != "typedef"))
+      return; // struct definitions are recorded when their body opens
+    const QString name = declaratorName(statement);
+    const QString signature = joinTokens(statement);
+    const int paren = statement.indexOf("(");
+    if (statement.first() == "typedef")
+      emitSymbol(Symbol::Type, name, signature);
+    else if (paren > 0 && paren + 1 < statement.size() &&
+             statement[paren + 1] != "*")
+      emitSymbol(Symbol::Function, name, signature);
+    else if (statement.size() == 2 &&
+             (statement[0] == "struct" || statement[0] == "union"))
+      emitSymbol(Symbol::Type, name, signature);
+    else
+      emitSymbol(Symbol::Variable, name, signature);
+  };
+
+  QStringList statement, member;
+  QString aggregate; // tag of the struct, union or enum being defined
+  bool isEnum = false, inFunctionBody = false;
+  int depth = 0;
+
+  auto emitMember = [&]() {
+    if (member.isEmpty())
+      return;
+    if (isEnum)
+      emitSymbol(Symbol::Variable, member.first(),
+                 aggregate + ": " + joinTokens(member));
+    else
+      emitSymbol(Symbol::Member, declaratorName(member),
+                 aggregate.isEmpty() ? joinTokens(member)
+                                     : aggregate + ": " + joinTokens(member));
+    member.clear();
+  };
+
+  for (int i = 0; i < tokens.size(); ++i) {
+    const QString &t = tokens[i];
+    if (t == "__attribute__" || t == "__asm__" || t == "__asm" ||
+        t == "__declspec") { // skip the parenthesized group that follows
+      int parens = 0;
+      while (i + 1 < tokens.size()) {
+        const QString &next = tokens[++i];
+        if (next == "(")
+          ++parens;
+        else if (next == ")" && --parens <= 0)
+          break;
+      }
+      continue;
+    }
+    if (t == "__extension__" || t == "__restrict" || t == "restrict" ||
+        t == "__inline" || t == "__inline__")
+      continue;
+
+    if (t == "{") {
+      if (depth++ == 0) {
+        if (!statement.isEmpty() && statement.last() == ")") {
+          inFunctionBody = true; // static inline function in a header
+          emitDeclaration(statement);
+          statement.clear();
+        } else {
+          int tag = std::max({statement.lastIndexOf("struct"),
+                              statement.lastIndexOf("union"),
+                              statement.lastIndexOf("enum")});
+          isEnum = tag >= 0 && statement[tag] == "enum";
+          aggregate.clear();
+          if (tag >= 0 && tag + 1 < statement.size()) {
+            aggregate = statement[tag] + ' ' + statement[tag + 1];
+            emitSymbol(Symbol::Type, statement[tag + 1], aggregate);
+          }
+          statement << "{}";
+        }
+      }
+      continue;
+    }
+    if (t == "}") {
+      if (depth == 1 && !inFunctionBody)
+        emitMember();
+      if (--depth <= 0) {
+        depth = 0;
+        inFunctionBody = false;
+      }
+      continue;
+    }
+    if (inFunctionBody)
+      continue;
+
+    if (depth == 0) {
+      if (t == ";") {
+        emitDeclaration(statement);
+        statement.clear();
+      } else {
+        statement << t;
+      }
+    } else if (depth == 1) {
+      if (t == ";" || (isEnum && t == ","))
+        emitMember();
+      else
+        member << t;
+    }
+  }
+  return symbols;
+}
+
+// when two declarations share a name, the first kind in this order wins
+int kindPriority(SymbolIndex::Symbol::Kind kind) {
+  static const SymbolIndex::Symbol::Kind order[] = {
+      SymbolIndex::Symbol::Function, SymbolIndex::Symbol::Variable,
+      SymbolIndex::Symbol::Type, SymbolIndex::Symbol::Macro,
+      SymbolIndex::Symbol::Member};
+  return int(std::find(std::begin(order), std::end(order), kind) -
+             std::begin(order));
+}
+} // namespace
+
+QString SymbolIndex::indexPath(const QString &compiler) {
+  QFileInfo info(compiler);
+  if (!info.exists())
+    info.setFile(QStandardPaths::findExecutable(compiler));
+
+  QByteArray key = info.absoluteFilePath().toUtf8();
+  key += QByteArray::number(info.lastModified().toMSecsSinceEpoch());
+  key += QByteArray::number(indexVersion);
+  return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+         "/symbols-" +
+         QCryptographicHash::hash(key, QCryptographicHash::Md5)
+             .toHex()
+             .left(16) +
+         ".idx";
+}
+
+bool SymbolIndex::build(const QString &compiler, const QString &indexPath) {
+  QProcess cpp;
+  cpp.start(compiler, {"-E", "-dD", "-x", "c", "-"});
+  if (!cpp.waitForStarted()) {
+    qDebug() << "Failed to start" << compiler << "for the symbol index";
+    return false;
+  }
+  for (auto header : indexedHeaders)
+    cpp.write(QByteArray("#if !defined(__has_include) || __has_include(<") +
+              header + ">)\n#include <" + header + ">\n#endif\n");
+  cpp.closeWriteChannel();
+  if (!cpp.waitForFinished(60000) || cpp.exitCode())
+    return false;
+
+  const auto symbols =
+      scanPreprocessed(QString::fromUtf8(cpp.readAllStandardOutput()));
+  struct Keyed {
+    QByteArray name;
+    int priority;
+    const Symbol *symbol;
+  };
+  std::vector<Keyed> keyed;
+  for (const auto &s : symbols)
+    keyed.push_back({s.name.toUtf8(), kindPriority(s.kind), &s});
+  std::stable_sort(keyed.begin(), keyed.end(),
+                   [](const Keyed &a, const Keyed &b) {
+                     return a.name != b.name ? a.name < b.name
+                                             : a.priority < b.priority;
+                   });
+  // one entry per name, except members which may repeat across structs
+  keyed.erase(std::unique(keyed.begin(), keyed.end(),
+                          [](const Keyed &a, const Keyed &b) {
+                            return a.name == b.name &&
+                                   b.symbol->kind != Symbol::Member;
+                          }),
+              keyed.end());
+
+  QByteArray strings;
+  std::vector<Entry> entries;
+  for (const auto &k : keyed) {
+    const QByteArray signature = k.symbol->signature.toUtf8().left(0xffff);
+    Entry e{};
+    e.nameOffset = quint32(strings.size());
+    e.nameLength = quint16(std::min(k.name.size(), 0xffff));
+    strings += k.name.left(e.nameLength);
+    e.signatureOffset = quint32(strings.size());
+    e.signatureLength = quint16(signature.size());
+    strings += signature;
+    e.kind = k.symbol->kind;
+    entries.push_back(e);
+  }
+
+  Header header{};
+  std::memcpy(header.magic, indexMagic, sizeof indexMagic);
+  header.version = indexVersion;
+  header.count = quint32(entries.size());
+  header.stringsOffset =
+      quint32(sizeof(Header) + entries.size() * sizeof(Entry));
+
+  QDir().mkpath(QFileInfo(indexPath).path());
+  QSaveFile file(indexPath);
+  if (!file.open(QFile::WriteOnly))
+    return false;
+  file.write(reinterpret_cast<const char *>(&header), sizeof header);
+  file.write(reinterpret_cast<const char *>(entries.data()),
+             qint64(entries.size() * sizeof(Entry)));
+  file.write(strings);
+  qDebug() << "Indexed" << entries.size() << "symbols of" << compiler;
+  return file.commit();
+}
+
+bool SymbolIndex::load(const QString &indexPath) {
+  m_header = nullptr, m_entries = nullptr, m_strings = nullptr;
+  m_file.close();
+  m_file.setFileName(indexPath);
+  if (!m_file.open(QFile::ReadOnly) || m_file.size() < qint64(sizeof(Header)))
+    return false;
+  const uchar *data = m_file.map(0, m_file.size());
+  if (!data)
+    return false;
+
+  auto header = reinterpret_cast<const Header *>(data);
+  if (std::memcmp(header->magic, indexMagic, sizeof indexMagic) ||
+      header->version != indexVersion ||
+      header->stringsOffset !=
+          sizeof(Header) + quint64(header->count) * sizeof(Entry) ||
+      header->stringsOffset > m_file.size()) {
+    m_file.close();
+    return false;
+  }
+  // checked once here so that the accessors can trust every entry of a
+  // truncated or corrupt file too
+  auto entries = reinterpret_cast<const Entry *>(data + sizeof(Header));
+  const quint64 stringsSize = quint64(m_file.size()) - header->stringsOffset;
+  for (quint32 i = 0; i < header->count; ++i) {
+    const Entry &e = entries[i];
+    if (quint64(e.nameOffset) + e.nameLength > stringsSize ||
+        quint64(e.signatureOffset) + e.signatureLength > stringsSize ||
+        e.kind > Symbol::Variable) {
+      m_file.close();
+      return false;
+    }
+  }
+  m_header = header;
+  m_entries = entries;
+  m_strings = reinterpret_cast<const char *>(data + header->stringsOffset);
+  return true;
+}
+
+int SymbolIndex::size() const { return m_header ? int(m_header->count) : 0; }
+
+const char *SymbolIndex::nameData(int i, int *length) const {
+  *length = m_entries[i].nameLength;
+  return m_strings + m_entries[i].nameOffset;
+}
+
+SymbolIndex::Symbol SymbolIndex::at(int i) const {
+  const Entry &e = m_entries[i];
+  return {Symbol::Kind(e.kind),
+          QString::fromUtf8(m_strings + e.nameOffset, e.nameLength),
+          QString::fromUtf8(m_strings + e.signatureOffset, e.signatureLength)};
+}
+
+int SymbolIndex::lowerBound(const QByteArray &name) const {
+  int first = 0, count = size();
+  while (count > 0) {
+    int step = count / 2, length;
+    const char *data = nameData(first + step, &length);
+    int cmp = std::memcmp(data, name.constData(),
+                          std::size_t(std::min(length, name.size())));
+    if (cmp < 0 || (cmp == 0 && length < name.size())) {
+      first += step + 1;
+      count -= step + 1;
+    } else {
+      count = step;
+    }
+  }
+  return first;
+}
+
+QVector<SymbolIndex::Symbol> SymbolIndex::find(const QString &name) const {
+  QVector<Symbol> result;
+  const QByteArray key = name.toUtf8();
+  for (int i = lowerBound(key); i < size(); ++i) {
+    int length;
+    const char *data = nameData(i, &length);
+    if (length != key.size() ||
+        std::memcmp(data, key.constData(), std::size_t(length)))
+      break;
+    result << at(i);
+  }
+  return result;
+}
+
+QVector<SymbolIndex::Symbol> SymbolIndex::withPrefix(const QString &prefix,
+                                                     int maxResults) const {
+  QVector<Symbol> result;
+  const QByteArray key = prefix.toUtf8();
+  for (int i = lowerBound(key); i < size() && result.size() < maxResults;
+       ++i) {
+    int length;
+    const char *data = nameData(i, &length);
+    if (length < key.size() ||
+        std::memcmp(data, key.constData(), std::size_t(key.size())))
+      break;
+    result << at(i);
+  }
+  return result;
+}
+
+QString SymbolIndex::kindName(Symbol::Kind kind) {
+  switch (kind) {
+  case Symbol::Macro:
+    return "macro";
+  case Symbol::Function:
+    return "function";
+  case Symbol::Type:
+    return "type";
+  case Symbol::Member:
+    return "member";
+  case Symbol::Variable:
+    return "variable";
+  }
+  return {};
+}
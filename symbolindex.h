@@ -0,0 +1,53 @@
+#ifndef SYMBOLINDEX_H
+#define SYMBOLINDEX_H
+
+#include <QFile>
+#include <QString>
+#include <QVector>
+
+// names declared by the toolchain's headers, kept in a memory mapped file
+// which is built once per compiler and is then just mapped at startup
+class SymbolIndex {
+public:
+  struct Symbol {
+    enum Kind : quint8 { Macro, Function, Type, Member, Variable } kind;
+    QString name;
+    QString signature;
+  };
+
+  SymbolIndex() = default;
+  SymbolIndex(const SymbolIndex &) = delete;
+  SymbolIndex &operator=(const SymbolIndex &) = delete;
+
+  // where the index of compiler is cached, changes when compiler does
+  static QString indexPath(const QString &compiler);
+  // preprocesses the standard headers with compiler and writes the index
+  static bool build(const QString &compiler, const QString &indexPath);
+
+  // maps the index, false if it is missing or outdated
+  bool load(const QString &indexPath);
+  bool isLoaded() const { return m_header != nullptr; }
+
+  int size() const;
+  Symbol at(int i) const;
+  // raw utf8 name of the i'th symbol, symbols are sorted by it
+  const char *nameData(int i, int *length) const;
+
+  QVector<Symbol> find(const QString &name) const;
+  QVector<Symbol> withPrefix(const QString &prefix, int maxResults) const;
+
+  static QString kindName(Symbol::Kind kind);
+
+private:
+  struct Header;
+  struct Entry;
+
+  QFile m_file;
+  const Header *m_header = nullptr;
+  const Entry *m_entries = nullptr;
+  const char *m_strings = nullptr;
+
+  int lowerBound(const QByteArray &name) const;
+};
+
+#endif // SYMBOLINDEX_H
@@ -0,0 +1,123 @@
+#include "testpanel.h"
+#include <QDir>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLocale>
+#include <QThread>
+
+namespace {
+enum Column { NameColumn, VerdictColumn, TimeColumn, MemoryColumn };
+}
+
+TestPanel::TestPanel(QWidget *parent)
+    : QWidget(parent), m_discover{tr("Discover")}, m_attach{tr("Attach...")},
+      m_run{tr("Run Tests")} {
+  m_directory.setText(QDir::currentPath());
+  m_comparison.addItems(
+      {tr("Exact"), tr("Ignore whitespace"), tr("Floats within 1e-6")});
+  m_comparison.setCurrentIndex(OutputComparator::Tokens);
+  m_jobs.setRange(1, 64);
+  m_jobs.setValue(QThread::idealThreadCount());
+  m_jobs.setPrefix(tr("Jobs: "));
+  m_timeLimit.setRange(100, 60000);
+  m_timeLimit.setSingleStep(500);
+  m_timeLimit.setValue(2000);
+  m_timeLimit.setSuffix(tr(" ms"));
+
+  auto controls = new QHBoxLayout;
+  controls->addWidget(&m_directory, 1);
+  controls->addWidget(&m_discover);
+  controls->addWidget(&m_attach);
+  controls->addWidget(&m_comparison);
+  controls->addWidget(&m_jobs);
+  controls->addWidget(&m_timeLimit);
+  controls->addWidget(&m_run);
+  controls->addWidget(&m_summary);
+  m_layout.setContentsMargins(0, 0, 0, 0);
+  m_layout.addLayout(controls);
+  m_layout.addWidget(&m_results);
+  setLayout(&m_layout);
+
+  m_results.setColumnCount(4);
+  m_results.setHeaderLabels(
+      {tr("Case"), tr("Verdict"), tr("Time"), tr("Memory")});
+  m_results.setRootIsDecorated(false);
+  m_results.header()->setSectionResizeMode(VerdictColumn,
+                                           QHeaderView::Stretch);
+
+  connect(&m_discover, &QPushButton::clicked, this, &TestPanel::discover);
+  connect(&m_directory, &QLineEdit::returnPressed, this,
+          &TestPanel::discover);
+  connect(&m_attach, &QPushButton::clicked, this, &TestPanel::attach);
+  connect(&m_run, &QPushButton::clicked, this, &TestPanel::runRequested);
+
+  connect(&m_runner, &TestRunner::caseStarted, [this](int index) {
+    m_results.topLevelItem(index)->setText(VerdictColumn, tr("Running"));
+  });
+  connect(&m_runner, &TestRunner::caseFinished,
+          [this](int index, const TestRunner::Result &result) {
+            auto item = m_results.topLevelItem(index);
+            item->setText(VerdictColumn,
+                          result.detail.isEmpty()
+                              ? TestRunner::verdictName(result.verdict)
+                              : QString("%1 (%2)")
+                                    .arg(TestRunner::verdictName(
+                                        result.verdict))
+                                    .arg(result.detail));
+            item->setForeground(VerdictColumn,
+                                result.verdict == TestRunner::Accepted
+                                    ? Qt::green
+                                    : Qt::red);
+            item->setText(TimeColumn,
+                          QString("%1 ms").arg(result.milliseconds));
+            item->setText(MemoryColumn,
+                          result.peakMemory < 0
+                              ? QString("-")
+                              : QLocale().formattedDataSize(
+                                    result.peakMemory));
+          });
+  connect(&m_runner, &TestRunner::finished, [this](int passed, int total) {
+    m_summary.setText(tr("%1/%2 passed").arg(passed).arg(total));
+  });
+
+  discover();
+}
+
+void TestPanel::discover() {
+  m_cases = TestRunner::discover(m_directory.text());
+  showCases();
+}
+
+void TestPanel::attach() {
+  const QStringList inputs = QFileDialog::getOpenFileNames(
+      this, tr("Attach Test Inputs"), m_directory.text(),
+      tr("Inputs (*.in *.txt);;All Files(*)"));
+  for (const auto &input : inputs) {
+    const QFileInfo info(input);
+    const QString expected = QFileDialog::getOpenFileName(
+        this, tr("Expected Output of %1").arg(info.fileName()),
+        info.absolutePath(), tr("Outputs (*.out *.ans *.txt);;All Files(*)"));
+    if (!expected.isEmpty())
+      m_cases.push_back({info.completeBaseName(), input, expected});
+  }
+  showCases();
+}
+
+void TestPanel::showCases() {
+  m_runner.stop();
+  m_results.clear();
+  for (const auto &testCase : m_cases)
+    new QTreeWidgetItem(&m_results, {testCase.name, tr("Not run")});
+  m_summary.setText(tr("%1 cases").arg(m_cases.size()));
+}
+
+void TestPanel::runAll(const QString &program) {
+  showCases();
+  m_runner.setJobs(m_jobs.value());
+  m_runner.setTimeLimit(m_timeLimit.value());
+  m_runner.setComparison(
+      static_cast<OutputComparator::Mode>(m_comparison.currentIndex()));
+  m_runner.run(program, m_cases);
+}
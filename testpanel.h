@@ -0,0 +1,44 @@
+#ifndef TESTPANEL_H
+#define TESTPANEL_H
+
+#include "testrunner.h"
+#include <QComboBox>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QSpinBox>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+#include <QWidget>
+
+// test cases of a directory, or attached one by one, run against the built
+// program with a verdict, time and memory per case
+class TestPanel : public QWidget {
+  Q_OBJECT
+public:
+  explicit TestPanel(QWidget *parent = nullptr);
+
+  // runs every case against program
+  void runAll(const QString &program);
+
+signals:
+  // Run Tests was clicked, the program is built first and then runAll
+  void runRequested();
+
+private:
+  TestRunner m_runner;
+  QVector<TestRunner::TestCase> m_cases;
+  QVBoxLayout m_layout;
+  QLineEdit m_directory;
+  QComboBox m_comparison;
+  QSpinBox m_jobs, m_timeLimit;
+  QPushButton m_discover, m_attach, m_run;
+  QTreeWidget m_results;
+  QLabel m_summary;
+
+  void discover();
+  void attach();
+  void showCases();
+};
+
+#endif // TESTPANEL_H
@@ -0,0 +1,300 @@
+#include "testrunner.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QThread>
+#include <cmath>
+
+namespace {
+const qint64 readAhead = 64 * 1024;
+const int watchInterval = 10; // ms
+
+bool isSpace(char c) {
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\f' ||
+         c == '\v';
+}
+
+// peak resident size of a running process, -1 where it is not known
+qint64 peakMemory(qint64 pid) {
+#ifdef Q_OS_LINUX
+  QFile status(QString("/proc/%1/status").arg(pid));
+  if (!status.open(QFile::ReadOnly))
+    return -1;
+  for (QByteArray line; !(line = status.readLine()).isEmpty();)
+    if (line.startsWith("VmHWM:")) // in kB
+      return line.mid(6).trimmed().split(' ').value(0).toLongLong() * 1024;
+#else
+  Q_UNUSED(pid)
+#endif
+  return -1;
+}
+} // namespace
+
+OutputComparator::OutputComparator(const QString &expectedPath, Mode mode,
+                                   double epsilon)
+    : m_expected{expectedPath}, m_mode{mode}, m_epsilon{epsilon} {
+  if (!m_expected.open(QFile::ReadOnly))
+    fail(QString("cannot read %1").arg(expectedPath));
+}
+
+OutputComparator::OutputComparator(const QByteArray &expected, Mode mode,
+                                   double epsilon)
+    : m_mode{mode}, m_epsilon{epsilon}, m_buffer{expected} {}
+
+bool OutputComparator::fail(const QString &mismatch) {
+  m_failed = true;
+  m_mismatch = mismatch;
+  return false;
+}
+
+int OutputComparator::nextExpectedByte() {
+  if (m_position == m_buffer.size()) {
+    if (!m_expected.isOpen())
+      return -1; // given in memory, or the file failed to open
+    m_buffer = m_expected.read(readAhead);
+    m_position = 0;
+    if (m_buffer.isEmpty())
+      return -1;
+  }
+  return uchar(m_buffer[m_position++]);
+}
+
+bool OutputComparator::nextExpectedToken(QByteArray *token) {
+  token->clear();
+  int c;
+  while ((c = nextExpectedByte()) >= 0 && isSpace(char(c)))
+    ;
+  for (; c >= 0 && !isSpace(char(c)); c = nextExpectedByte())
+    *token += char(c);
+  return !token->isEmpty();
+}
+
+bool OutputComparator::compareToken(const QByteArray &token) {
+  ++m_compared;
+  QByteArray expected;
+  if (!nextExpectedToken(&expected))
+    return fail(QString("extra output \"%1\"").arg(QString(token.left(40))));
+  if (token == expected)
+    return true;
+  if (m_mode == Float) {
+    bool outputOk, expectedOk;
+    const double a = token.toDouble(&outputOk),
+                 b = expected.toDouble(&expectedOk);
+    if (outputOk && expectedOk &&
+        std::abs(a - b) <= m_epsilon * std::max(1.0, std::abs(b)))
+      return true;
+  }
+  return fail(QString("token %1: expected \"%2\", got \"%3\"")
+                  .arg(m_compared)
+                  .arg(QString(expected.left(40)))
+                  .arg(QString(token.left(40))));
+}
+
+bool OutputComparator::feed(const QByteArray &output) {
+  if (m_failed)
+    return false;
+
+  if (m_mode == Exact) {
+    for (char c : output) {
+      if (c == '\r')
+        continue;
+      int e;
+      while ((e = nextExpectedByte()) == '\r')
+        ;
+      ++m_compared;
+      if (e < 0 ? !isSpace(c) : e != uchar(c))
+        return fail(QString("differs at byte %1").arg(m_compared));
+    }
+    return true;
+  }
+
+  int start = 0;
+  for (int i = 0; i < output.size(); ++i) {
+    if (!isSpace(output[i]))
+      continue;
+    m_partial += output.mid(start, i - start);
+    start = i + 1;
+    if (!m_partial.isEmpty() && !compareToken(m_partial))
+      return false;
+    m_partial.clear();
+  }
+  m_partial += output.mid(start);
+  return true;
+}
+
+bool OutputComparator::finish() {
+  if (m_failed)
+    return false;
+  if (m_mode != Exact) {
+    if (!m_partial.isEmpty() && !compareToken(m_partial))
+      return false;
+    QByteArray missing;
+    if (nextExpectedToken(&missing))
+      return fail(QString("output ends before \"%1\"")
+                      .arg(QString(missing.left(40))));
+    return true;
+  }
+  for (int e; (e = nextExpectedByte()) >= 0;)
+    if (!isSpace(char(e)))
+      return fail("output ends too early");
+  return true;
+}
+
+TestRunner::TestRunner(QObject *parent)
+    : QObject(parent), m_jobs{QThread::idealThreadCount()} {
+  m_watchdog.setInterval(watchInterval);
+  connect(&m_watchdog, &QTimer::timeout, this, &TestRunner::watch);
+}
+
+TestRunner::~TestRunner() { stop(); }
+
+QVector<TestRunner::TestCase> TestRunner::discover(const QString &directory) {
+  QVector<TestCase> cases;
+  const QDir dir(directory);
+  for (const QFileInfo &input :
+       dir.entryInfoList({"*.in"}, QDir::Files, QDir::Name)) {
+    for (const char *suffix : {".out", ".ans"}) {
+      const QString expected =
+          dir.filePath(input.completeBaseName() + suffix);
+      if (QFileInfo::exists(expected)) {
+        cases.push_back(
+            {input.completeBaseName(), input.filePath(), expected});
+        break;
+      }
+    }
+  }
+  return cases;
+}
+
+QString TestRunner::verdictName(Verdict verdict) {
+  switch (verdict) {
+  case Accepted:
+    return tr("Accepted");
+  case WrongAnswer:
+    return tr("Wrong answer");
+  case TimeLimit:
+    return tr("Time limit exceeded");
+  case RuntimeError:
+    return tr("Runtime error");
+  case Failed:
+    break;
+  }
+  return tr("Failed to run");
+}
+
+void TestRunner::run(const QString &program, const QVector<TestCase> &cases) {
+  stop();
+  m_program = program;
+  m_cases = cases;
+  m_next = m_passed = m_done = 0;
+  if (m_cases.isEmpty()) {
+    emit finished(0, 0);
+    return;
+  }
+  m_watchdog.start();
+  while (int(m_running.size()) < m_jobs && m_next < m_cases.size())
+    startNext();
+}
+
+void TestRunner::stop() {
+  m_next = m_cases.size();
+  for (auto &job : m_running) {
+    job->process.disconnect(this);
+    job->process.kill();
+    job->process.waitForFinished(100);
+  }
+  m_running.clear();
+  m_watchdog.stop();
+}
+
+void TestRunner::startNext() {
+  const int index = m_next++;
+  const TestCase &testCase = m_cases[index];
+  m_running.push_back(std::make_unique<Job>());
+  Job *job = m_running.back().get();
+  job->index = index;
+  job->comparator = std::make_unique<OutputComparator>(testCase.expected,
+                                                       m_mode, m_epsilon);
+
+  // the output is judged while it streams in, a wrong one ends the run early
+  job->process.setStandardInputFile(testCase.input);
+  job->process.setStandardErrorFile(QProcess::nullDevice());
+  connect(&job->process, &QProcess::readyReadStandardOutput, this, [job]() {
+    if (!job->comparator->feed(job->process.readAllStandardOutput()) &&
+        !job->wrong) {
+      job->wrong = true;
+      job->process.kill();
+    }
+  });
+  connect(&job->process,
+          QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this,
+          [this, job](int exitCode, QProcess::ExitStatus status) {
+            jobFinished(job, exitCode, status);
+          });
+  connect(&job->process, &QProcess::errorOccurred, this,
+          [this, job](QProcess::ProcessError error) {
+            if (error == QProcess::FailedToStart)
+              jobFinished(job, -1, QProcess::CrashExit);
+          });
+
+  emit caseStarted(index);
+  job->elapsed.start();
+  job->process.start(m_program, QStringList());
+}
+
+void TestRunner::watch() {
+  for (auto &job : m_running) {
+    if (job->process.state() != QProcess::Running)
+      continue;
+    job->peakMemory =
+        std::max(job->peakMemory, peakMemory(job->process.processId()));
+    if (!job->timedOut && job->elapsed.elapsed() > m_timeLimit) {
+      job->timedOut = true;
+      job->process.kill();
+    }
+  }
+}
+
+void TestRunner::jobFinished(Job *job, int exitCode,
+                             QProcess::ExitStatus status) {
+  Result result{Accepted, job->elapsed.elapsed(), job->peakMemory, {}};
+  if (job->process.error() == QProcess::FailedToStart) {
+    result.verdict = Failed;
+    result.detail = job->process.errorString();
+  } else if (job->timedOut) {
+    result.verdict = TimeLimit;
+  } else if (job->wrong) {
+    result.verdict = WrongAnswer;
+    result.detail = job->comparator->mismatch();
+  } else if (status == QProcess::CrashExit || exitCode != 0) {
+    result.verdict = RuntimeError;
+    result.detail = QString("exit code %1").arg(exitCode);
+  } else {
+    job->comparator->feed(job->process.readAllStandardOutput());
+    if (!job->comparator->finish()) {
+      result.verdict = WrongAnswer;
+      result.detail = job->comparator->mismatch();
+    }
+  }
+  if (result.verdict == Accepted)
+    ++m_passed;
+  ++m_done;
+  emit caseFinished(job->index, result);
+
+  // the process is still delivering this signal, so it is deleted later
+  auto it = std::find_if(m_running.begin(), m_running.end(),
+                         [job](const auto &j) { return j.get() == job; });
+  if (it != m_running.end()) {
+    it->release();
+    m_running.erase(it);
+    job->process.disconnect(this);
+    QMetaObject::invokeMethod(this, [job]() { delete job; },
+                              Qt::QueuedConnection);
+  }
+
+  if (m_next < m_cases.size())
+    startNext();
+  else if (m_running.empty()) {
+    m_watchdog.stop();
+    emit finished(m_passed, m_cases.size());
+  }
+}
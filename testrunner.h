@@ -0,0 +1,117 @@
+#ifndef TESTRUNNER_H
+#define TESTRUNNER_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QObject>
+#include <QProcess>
+#include <QTimer>
+#include <QVector>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+// compares a program's output with an expected output file piece by piece,
+// as the output arrives
+class OutputComparator {
+public:
+  enum Mode {
+    Exact,  // byte for byte, except '\r' and trailing whitespace
+    Tokens, // whitespace separated tokens, however they are spaced
+    Float   // tokens, numbers within a relative or absolute epsilon
+  };
+
+  OutputComparator(const QString &expectedPath, Mode mode, double epsilon);
+  // compares with an expected output that is in memory already
+  OutputComparator(const QByteArray &expected, Mode mode, double epsilon);
+
+  // false once the output can no longer match
+  bool feed(const QByteArray &output);
+  // whether the complete output matched
+  bool finish();
+  // where the output went wrong
+  const QString &mismatch() const { return m_mismatch; }
+
+private:
+  QFile m_expected;
+  Mode m_mode;
+  double m_epsilon;
+  bool m_failed = false;
+  QString m_mismatch;
+  QByteArray m_buffer; // read ahead of the expected file, or all of it
+  int m_position = 0;
+  QByteArray m_partial; // output token cut by the end of a chunk
+  qint64 m_compared = 0; // bytes or tokens, depending on the mode
+
+  int nextExpectedByte();
+  bool nextExpectedToken(QByteArray *token);
+  bool compareToken(const QByteArray &token);
+  bool fail(const QString &mismatch);
+};
+
+// runs a program on many input files at once and judges each output
+class TestRunner : public QObject {
+  Q_OBJECT
+public:
+  struct TestCase {
+    QString name, input, expected;
+  };
+  enum Verdict { Accepted, WrongAnswer, TimeLimit, RuntimeError, Failed };
+  struct Result {
+    Verdict verdict;
+    qint64 milliseconds;
+    qint64 peakMemory; // bytes, -1 where it cannot be measured
+    QString detail;
+  };
+
+  explicit TestRunner(QObject *parent = nullptr);
+  ~TestRunner() override;
+
+  // the name.in files of directory that have a name.out or name.ans next to
+  // them
+  static QVector<TestCase> discover(const QString &directory);
+
+  void setJobs(int jobs) { m_jobs = std::max(jobs, 1); }
+  void setTimeLimit(int milliseconds) { m_timeLimit = milliseconds; }
+  void setComparison(OutputComparator::Mode mode, double epsilon = 1e-6) {
+    m_mode = mode;
+    m_epsilon = epsilon;
+  }
+
+  void run(const QString &program, const QVector<TestCase> &cases);
+  void stop();
+  bool isRunning() const { return !m_running.empty(); }
+
+  static QString verdictName(Verdict verdict);
+
+signals:
+  void caseStarted(int index);
+  void caseFinished(int index, const TestRunner::Result &result);
+  void finished(int passed, int total);
+
+private:
+  struct Job {
+    int index;
+    QProcess process;
+    std::unique_ptr<OutputComparator> comparator;
+    QElapsedTimer elapsed;
+    qint64 peakMemory = -1;
+    bool wrong = false, timedOut = false;
+  };
+
+  QString m_program;
+  QVector<TestCase> m_cases;
+  std::vector<std::unique_ptr<Job>> m_running;
+  int m_next = 0, m_passed = 0, m_done = 0;
+  int m_jobs, m_timeLimit = 2000;
+  OutputComparator::Mode m_mode = OutputComparator::Tokens;
+  double m_epsilon = 1e-6;
+  QTimer m_watchdog; // enforces the time limit and samples memory
+
+  void startNext();
+  void jobFinished(Job *job, int exitCode, QProcess::ExitStatus status);
+  void watch();
+};
+
+#endif // TESTRUNNER_H
@@ -0,0 +1,119 @@
+#include "textencoding.h"
+#include <QTextCodec>
+#include <algorithm>
+
+namespace {
+const char utf8Bom[] = "\xEF\xBB\xBF";
+
+// the line ending used by most lines of text
+TextEncoding::LineEnding dominantLineEnding(const QString &text) {
+  qint64 lf = 0, crlf = 0, cr = 0;
+  const QChar *p = text.constData(), *end = p + text.size();
+  for (; p != end; ++p) {
+    if (*p == '\n')
+      ++lf;
+    else if (*p == '\r') {
+      if (p + 1 != end && p[1] == '\n')
+        ++crlf, ++p;
+      else
+        ++cr;
+    }
+  }
+  if (crlf > lf && crlf >= cr)
+    return TextEncoding::CRLF;
+  return cr > lf ? TextEncoding::CR : TextEncoding::LF;
+}
+
+// turns "\r\n" and lone '\r' into '\n' in place, in a single pass
+void normalizeLineEndings(QString &text) {
+  if (!text.contains('\r'))
+    return;
+  QChar *out = text.data(), *in = out, *end = out + text.size();
+  for (; in != end; ++in) {
+    if (*in == '\r') {
+      *out++ = '\n';
+      if (in + 1 != end && in[1] == '\n')
+        ++in;
+    } else {
+      *out++ = *in;
+    }
+  }
+  text.truncate(int(out - text.data()));
+}
+} // namespace
+
+QString TextEncoding::decode(const QByteArray &contents,
+                             TextEncoding *encoding) {
+  TextEncoding detected;
+  QString text;
+  const auto *bytes = reinterpret_cast<const uchar *>(contents.constData());
+  if (contents.startsWith(utf8Bom)) {
+    detected.bom = true;
+    text = QString::fromUtf8(contents.constData() + 3, contents.size() - 3);
+  } else if (contents.size() >= 2 &&
+             ((bytes[0] == 0xFF && bytes[1] == 0xFE) ||
+              (bytes[0] == 0xFE && bytes[1] == 0xFF))) {
+    detected.codec = bytes[0] == 0xFF ? Utf16LE : Utf16BE;
+    detected.bom = true;
+    // the codec consumes the byte order mark
+    text = QTextCodec::codecForName("UTF-16")->toUnicode(contents);
+  } else {
+    // decoded in a single pass, which counts the malformed sequences and a
+    // sequence cut off at the end
+    QTextCodec::ConverterState state;
+    text = QTextCodec::codecForName("UTF-8")->toUnicode(
+        contents.constData(), contents.size(), &state);
+    if (state.invalidChars || state.remainingChars) {
+      detected.codec = Latin1;
+      text = QString::fromLatin1(contents);
+    }
+  }
+
+  detected.lineEnding = dominantLineEnding(text);
+  normalizeLineEndings(text);
+  if (encoding)
+    *encoding = detected;
+  return text;
+}
+
+bool TextEncoding::canEncode(const QString &text) const {
+  return codec != Latin1 ||
+         std::none_of(text.begin(), text.end(),
+                      [](QChar c) { return c.unicode() > 0xFF; });
+}
+
+QByteArray TextEncoding::encode(const QString &text) const {
+  QString stored = text;
+  if (lineEnding == CRLF)
+    stored.replace('\n', QLatin1String("\r\n"));
+  else if (lineEnding == CR)
+    stored.replace('\n', '\r');
+
+  switch (codec) {
+  case Utf16LE:
+  case Utf16BE: {
+    auto codec = QTextCodec::codecForName(
+        this->codec == Utf16LE ? "UTF-16LE" : "UTF-16BE");
+    QByteArray result = bom ? QByteArray(this->codec == Utf16LE ? "\xFF\xFE"
+                                                                : "\xFE\xFF",
+                                         2)
+                            : QByteArray();
+    return result + codec->fromUnicode(stored);
+  }
+  case Latin1:
+    return stored.toLatin1();
+  case Utf8:
+    break;
+  }
+  return bom ? QByteArray(utf8Bom) + stored.toUtf8() : stored.toUtf8();
+}
+
+QString TextEncoding::name() const {
+  static const char *const codecs[] = {"UTF-8", "UTF-16 LE", "UTF-16 BE",
+                                       "Latin-1"};
+  static const char *const lineEndings[] = {"LF", "CRLF", "CR"};
+  return QString("%1%2 %3")
+      .arg(codecs[codec])
+      .arg(bom ? " BOM" : "")
+      .arg(lineEndings[lineEnding]);
+}
@@ -0,0 +1,28 @@
+#ifndef TEXTENCODING_H
+#define TEXTENCODING_H
+
+#include <QByteArray>
+#include <QString>
+
+// how a source file is stored on disk, so it can be edited with plain '\n'
+// line breaks and written back the way it was
+struct TextEncoding {
+  enum Codec : quint8 { Utf8, Utf16LE, Utf16BE, Latin1 };
+  enum LineEnding : quint8 { LF, CRLF, CR };
+
+  Codec codec = Utf8;
+  bool bom = false;
+  LineEnding lineEnding = LF;
+
+  // detects the encoding of contents and returns its text with '\n' line
+  // breaks; bytes that are not valid utf8 make the file read as latin1
+  static QString decode(const QByteArray &contents, TextEncoding *encoding);
+  // whether every character of text can be stored, latin1 stores a few
+  bool canEncode(const QString &text) const;
+  // characters that cannot be stored become '?', see canEncode
+  QByteArray encode(const QString &text) const;
+
+  QString name() const;
+};
+
+#endif // TEXTENCODING_H
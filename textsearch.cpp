@@ -0,0 +1,228 @@
+#include "textsearch.h"
+#include <QTextCursor>
+#include <QTextDocument>
+#include <algorithm>
+
+namespace {
+// blocks counted per timer tick, and per edit before giving up and
+// recounting everything in the background
+const int countChunk = 4096, inlineRecountLimit = 256;
+
+bool isWordChar(QChar c) { return c.isLetterOrNumber() || c == '_'; }
+} // namespace
+
+TextSearch::TextSearch(QTextDocument *document, QObject *parent)
+    : QObject(parent), m_document{document} {
+  m_countTimer.setInterval(0);
+  connect(&m_countTimer, &QTimer::timeout, this, &TextSearch::countSome);
+  connect(m_document, &QTextDocument::contentsChange, this,
+          &TextSearch::contentsChange);
+}
+
+void TextSearch::setQuery(const QString &pattern, Mode mode,
+                          Qt::CaseSensitivity cs) {
+  m_mode = mode;
+  m_cs = cs;
+  m_pattern = cs == Qt::CaseSensitive ? pattern : pattern.toCaseFolded();
+  if (mode == Regex) {
+    m_regex.setPattern(pattern);
+    m_regex.setPatternOptions(cs == Qt::CaseSensitive
+                                  ? QRegularExpression::NoPatternOption
+                                  : QRegularExpression::CaseInsensitiveOption);
+    m_regex.optimize();
+    if (!m_regex.isValid())
+      m_pattern.clear();
+  } else {
+    const int m = m_pattern.size();
+    std::fill(std::begin(m_skip), std::end(m_skip), std::max(m, 1));
+    for (int k = 0; k + 1 < m; ++k)
+      m_skip[m_pattern[k].unicode() & 0xff] = m - 1 - k;
+  }
+  restartCount();
+  emit queryChanged();
+}
+
+void TextSearch::clear() { setQuery({}, m_mode, m_cs); }
+
+QString TextSearch::errorString() const {
+  return m_mode == Regex && !m_regex.isValid() ? m_regex.errorString()
+                                               : QString();
+}
+
+int TextSearch::indexIn(const QString &text, int from) const {
+  const int m = m_pattern.size(), n = text.size();
+  if (m == 1 && m_cs == Qt::CaseSensitive) // vectorized by QString
+    return text.indexOf(m_pattern[0], from);
+
+  const QChar *t = text.constData(), *p = m_pattern.constData();
+  const bool fold = m_cs == Qt::CaseInsensitive;
+  for (int i = from; i + m <= n;) {
+    int j = m - 1;
+    while (j >= 0 && (fold ? t[i + j].toCaseFolded() : t[i + j]) == p[j])
+      --j;
+    if (j < 0)
+      return i;
+    const QChar last = fold ? t[i + m - 1].toCaseFolded() : t[i + m - 1];
+    i += m_skip[last.unicode() & 0xff];
+  }
+  return -1;
+}
+
+QVector<TextSearch::Match> TextSearch::matches(const QTextBlock &block) const {
+  QVector<Match> result;
+  if (!isActive())
+    return result;
+  const QString text = block.text();
+  const int offset = block.position();
+
+  if (m_mode == Regex) {
+    auto it = m_regex.globalMatch(text);
+    while (it.hasNext()) {
+      const auto match = it.next();
+      if (match.capturedLength() == 0)
+        continue;
+      result.push_back({offset + match.capturedStart(), match.capturedLength(),
+                        match.capturedTexts()});
+    }
+    return result;
+  }
+
+  const int m = m_pattern.size();
+  for (int i = indexIn(text, 0); i >= 0; i = indexIn(text, i + 1)) {
+    if (m_mode == WholeWord &&
+        ((i > 0 && isWordChar(text[i - 1])) ||
+         (i + m < text.size() && isWordChar(text[i + m]))))
+      continue;
+    result.push_back({offset + i, m, {}});
+    i += m - 1; // matches do not overlap
+  }
+  return result;
+}
+
+TextSearch::Match TextSearch::findNext(int position, bool backward) const {
+  if (!isActive())
+    return {};
+  // the start block is visited twice, the second time for what precedes
+  // position after wrapping around
+  QTextBlock block = m_document->findBlock(position);
+  for (int step = 0; step <= m_document->blockCount(); ++step) {
+    auto found = matches(block);
+    if (backward)
+      std::reverse(found.begin(), found.end());
+    for (const auto &match : found)
+      if (step > 0 || (backward ? match.position + match.length <= position
+                                : match.position >= position))
+        return match;
+    block = backward ? block.previous() : block.next();
+    if (!block.isValid())
+      block = backward ? m_document->lastBlock() : m_document->firstBlock();
+  }
+  return {};
+}
+
+QString TextSearch::replacementFor(const Match &match,
+                                   const QString &replacement) const {
+  if (m_mode != Regex)
+    return replacement;
+  QString result;
+  for (int i = 0; i < replacement.size(); ++i) {
+    const QChar c = replacement[i];
+    if (c == '\\' && i + 1 < replacement.size() &&
+        replacement[i + 1].isDigit()) {
+      result += match.captures.value(replacement[++i].digitValue());
+    } else {
+      result += c;
+    }
+  }
+  return result;
+}
+
+int TextSearch::replaceAll(const QString &replacement) {
+  QVector<Match> all;
+  for (auto block = m_document->firstBlock(); block.isValid();
+       block = block.next())
+    all += matches(block);
+
+  // back to front, so the positions of the remaining matches stay valid;
+  // the highlighter only sees the change once the edit block is closed
+  QTextCursor cursor(m_document);
+  cursor.beginEditBlock();
+  for (auto it = all.crbegin(); it != all.crend(); ++it) {
+    cursor.setPosition(it->position);
+    cursor.setPosition(it->position + it->length, QTextCursor::KeepAnchor);
+    cursor.insertText(replacementFor(*it, replacement));
+  }
+  cursor.endEditBlock();
+  return all.size();
+}
+
+void TextSearch::restartCount() {
+  m_blockCount = m_document->blockCount();
+  m_blockCounts.fill(-1, isActive() ? m_blockCount : 0);
+  m_total = 0;
+  m_countCursor = 0;
+  m_countBlock = m_document->firstBlock();
+  if (isActive()) {
+    m_countTimer.start();
+  } else {
+    m_countTimer.stop();
+    emit matchCountChanged(0, true);
+  }
+}
+
+void TextSearch::countSome() {
+  for (int n = 0; n < countChunk && m_countBlock.isValid();
+       ++n, ++m_countCursor, m_countBlock = m_countBlock.next()) {
+    if (m_blockCounts[m_countCursor] >= 0)
+      continue;
+    m_blockCounts[m_countCursor] = matches(m_countBlock).size();
+    m_total += m_blockCounts[m_countCursor];
+  }
+  const bool complete = !m_countBlock.isValid();
+  if (complete)
+    m_countTimer.stop();
+  emit matchCountChanged(m_total, complete);
+}
+
+void TextSearch::contentsChange(int position, int /*charsRemoved*/,
+                                int charsAdded) {
+  if (!isActive())
+    return;
+  const int delta = m_document->blockCount() - m_blockCount;
+  const QTextBlock first = m_document->findBlock(position),
+                   last = m_document->findBlock(position + charsAdded);
+  const int firstNumber = first.blockNumber(),
+            lastNumber = last.isValid() ? last.blockNumber()
+                                        : m_document->blockCount() - 1;
+  if (lastNumber - firstNumber > inlineRecountLimit ||
+      m_blockCounts.size() != m_blockCount) {
+    restartCount();
+    return;
+  }
+
+  // blocks firstNumber .. lastNumber - delta were replaced by the blocks
+  // firstNumber .. lastNumber
+  for (int i = firstNumber; i <= lastNumber - delta; ++i)
+    m_total -= std::max(m_blockCounts[i], 0);
+  m_blockCounts.remove(firstNumber, lastNumber - delta - firstNumber + 1);
+  int i = firstNumber;
+  for (auto block = first; i <= lastNumber; block = block.next(), ++i) {
+    const int count = matches(block).size();
+    m_blockCounts.insert(i, count);
+    m_total += count;
+  }
+  m_blockCount = m_document->blockCount();
+
+  // the highlighter marks blocks as changed too, so this is not rare while a
+  // background count is running
+  if (isCounting()) {
+    // the blocks from firstNumber on were just counted and are skipped, so
+    // a cursor in the removed blocks goes back to the first of them
+    if (firstNumber < m_countCursor) {
+      m_countCursor = std::max(firstNumber, m_countCursor + delta);
+      m_countBlock = m_document->findBlockByNumber(m_countCursor);
+    }
+    return;
+  }
+  emit matchCountChanged(m_total, true);
+}
@@ -0,0 +1,71 @@
+#ifndef TEXTSEARCH_H
+#define TEXTSEARCH_H
+
+#include <QObject>
+#include <QRegularExpression>
+#include <QStringList>
+#include <QTextBlock>
+#include <QTimer>
+#include <QVector>
+
+class QTextDocument;
+
+// finds a pattern block by block, straight on the document's blocks, and keeps
+// the number of matches up to date as the document changes
+class TextSearch : public QObject {
+  Q_OBJECT
+public:
+  enum Mode { Literal, WholeWord, Regex };
+
+  struct Match {
+    int position = -1, length = 0;
+    QStringList captures; // only for Regex
+    bool isValid() const { return position >= 0; }
+  };
+
+  explicit TextSearch(QTextDocument *document, QObject *parent = nullptr);
+
+  void setQuery(const QString &pattern, Mode mode, Qt::CaseSensitivity cs);
+  void clear();
+  bool isActive() const { return !m_pattern.isEmpty(); }
+  // why the query matches nothing, e.g. an invalid regular expression
+  QString errorString() const;
+
+  QVector<Match> matches(const QTextBlock &block) const;
+  // the first match starting after position, or ending before it when going
+  // backward, wrapping around the document
+  Match findNext(int position, bool backward = false) const;
+
+  // the text replacement expands to for match, \1 ... \9 refer to captures
+  QString replacementFor(const Match &match, const QString &replacement) const;
+  // replaces every match as a single undo step, returns their number
+  int replaceAll(const QString &replacement);
+
+  int matchCount() const { return m_total; }
+  bool isCounting() const { return m_countTimer.isActive(); }
+
+signals:
+  void queryChanged();
+  void matchCountChanged(int count, bool complete);
+
+private:
+  QTextDocument *m_document;
+  QString m_pattern; // case folded unless the search is case sensitive
+  Mode m_mode = Literal;
+  Qt::CaseSensitivity m_cs = Qt::CaseInsensitive;
+  QRegularExpression m_regex;
+  int m_skip[256]; // Boyer-Moore-Horspool shifts, by the low byte of a char
+
+  // matches per block, -1 while not counted yet
+  QVector<int> m_blockCounts;
+  int m_total = 0, m_countCursor = 0, m_blockCount = 0;
+  QTextBlock m_countBlock;
+  QTimer m_countTimer;
+
+  int indexIn(const QString &text, int from) const;
+  void countSome();
+  void restartCount();
+  void contentsChange(int position, int charsRemoved, int charsAdded);
+};
+
+#endif // TEXTSEARCH_H
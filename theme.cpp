@@ -0,0 +1,64 @@
+#include "theme.h"
+#include <QApplication>
+#include <QColor>
+
+namespace {
+Theme makeDarkTheme() {
+  Theme theme;
+  const QColor baseColor = QColor("#3c3c3c").darker(),
+               secondaryColor("#2c2c2c"), textColor(Qt::white);
+
+  QPalette &p = theme.palette;
+  p.setColor(QPalette::Window, baseColor);
+  p.setColor(QPalette::WindowText, textColor);
+  p.setColor(QPalette::Base, baseColor);
+  p.setColor(QPalette::AlternateBase, secondaryColor);
+  p.setColor(QPalette::Text, textColor);
+  p.setColor(QPalette::Button, baseColor);
+  p.setColor(QPalette::ButtonText, textColor);
+  p.setColor(QPalette::Highlight, secondaryColor);
+  p.setColor(QPalette::HighlightedText, textColor);
+  p.setColor(QPalette::ToolTipBase, QColor("#80CBC4"));
+  p.setColor(QPalette::ToolTipText, Qt::black);
+  p.setColor(QPalette::Dark, Qt::black); // splitter handles
+
+  theme.editorPalette = p;
+  theme.editorPalette.setColor(QPalette::Base, QColor("#363640"));
+
+  theme.font = QFont("Roboto");
+  theme.editorFont = QFont("Courier New");
+  theme.editorFont.setPixelSize(16);
+
+  auto &formats = theme.tokenFormats;
+  formats[Keyword].setForeground(QColor("#90CAF9"));
+  formats[Class].setForeground(QColor("#9CCC65"));
+  formats[Quotation].setForeground(QColor("#E6EE9C"));
+  formats[Function].setFontItalic(true);
+  formats[Function].setForeground(QColor("#FFF176"));
+  formats[Comment].setForeground(QColor("#546E7A"));
+  formats[Directive].setForeground(QColor("orange"));
+
+  auto &semantic = theme.semanticFormats;
+  for (const char *type : {"type", "class", "struct", "enum", "typeParameter"})
+    semantic[type] = formats[Class];
+  for (const char *type : {"function", "method"})
+    semantic[type] = formats[Function];
+  semantic["macro"] = formats[Directive];
+  semantic["parameter"].setFontItalic(true);
+  semantic["property"].setForeground(QColor("#80CBC4"));
+  semantic["enumMember"].setForeground(QColor("#CE93D8"));
+  return theme;
+}
+} // namespace
+
+const Theme &Theme::dark() {
+  static const Theme theme = makeDarkTheme();
+  return theme;
+}
+
+void Theme::apply(QApplication &app) const {
+  app.setPalette(palette);
+  app.setFont(font);
+  app.setPalette(editorPalette, "QPlainTextEdit");
+  app.setFont(editorFont, "QPlainTextEdit");
+}
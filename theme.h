@@ -0,0 +1,27 @@
+#ifndef THEME_H
+#define THEME_H
+
+#include "cppsyntaxhightlighter.h"
+#include <QFont>
+#include <QHash>
+#include <QPalette>
+#include <QTextCharFormat>
+
+class QApplication;
+
+// colours and fonts of the ui, built once and applied through palettes and
+// format tables instead of a style sheet that is parsed on every start
+struct Theme {
+  QPalette palette;
+  QPalette editorPalette; // of every QPlainTextEdit
+  QFont font, editorFont;
+  QTextCharFormat tokenFormats[TokenClassCount];
+  // by the type of a language server's semantic token, drawn over the
+  // tokens above
+  QHash<QString, QTextCharFormat> semanticFormats;
+
+  static const Theme &dark();
+  void apply(QApplication &app) const;
+};
+
+#endif // THEME_H
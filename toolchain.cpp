@@ -0,0 +1,164 @@
+#include "toolchain.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace {
+// in order of preference, the bundled compilers first
+const char *const candidates[] = {"./Mingw/bin/gcc.exe", "gcc", "clang",
+                                  "./tcc/tcc.exe", "tcc"};
+
+QString resolve(const QString &program) {
+  QFileInfo info(program);
+  if (!info.exists())
+    info.setFile(QStandardPaths::findExecutable(program));
+  return info.exists() ? info.canonicalFilePath() : QString();
+}
+} // namespace
+
+Toolchain::Toolchain(Kind kind, const QString &program, const QString &version)
+    : m_kind{kind}, m_program{program}, m_version{version} {}
+
+QString Toolchain::cachePath() {
+  return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+         "/toolchains.json";
+}
+
+const QVector<Toolchain> &Toolchain::available() {
+  static const QVector<Toolchain> toolchains = []() {
+    QJsonObject cache;
+    QFile cacheFile(cachePath());
+    if (cacheFile.open(QFile::ReadOnly))
+      cache = QJsonDocument::fromJson(cacheFile.readAll()).object();
+    cacheFile.close();
+    bool cacheChanged = false;
+
+    QVector<Toolchain> result;
+    QStringList seen;
+    for (const char *candidate : candidates) {
+      const QString path = resolve(candidate);
+      if (path.isEmpty() || seen.contains(path))
+        continue;
+      seen << path;
+
+      // an executable that changed since it was probed is probed again
+      const double mtime =
+          QFileInfo(path).lastModified().toMSecsSinceEpoch();
+      QJsonObject entry = cache.value(path).toObject();
+      if (entry.value("mtime").toDouble() != mtime) {
+        Kind kind;
+        QString version;
+        if (!probe(candidate, &kind, &version))
+          continue;
+        entry = {{"mtime", mtime}, {"kind", kind}, {"version", version}};
+        cache.insert(path, entry);
+        cacheChanged = true;
+      }
+      // keep the name it was found by, the bundled gcc needs its relative
+      // path to find the rest of Mingw
+      result.push_back({Kind(entry.value("kind").toInt()), candidate,
+                        entry.value("version").toString()});
+    }
+    std::stable_sort(result.begin(), result.end(),
+                     [](const Toolchain &a, const Toolchain &b) {
+                       return !a.canRunInMemory() && b.canRunInMemory();
+                     });
+
+    if (cacheChanged) {
+      QDir().mkpath(QFileInfo(cachePath()).absolutePath());
+      QSaveFile out(cachePath());
+      if (out.open(QFile::WriteOnly)) {
+        out.write(QJsonDocument(cache).toJson(QJsonDocument::Compact));
+        out.commit();
+      }
+    }
+    for (const auto &toolchain : result)
+      qDebug() << "Toolchain" << toolchain.name() << toolchain.program();
+    return result;
+  }();
+  return toolchains;
+}
+
+const Toolchain *Toolchain::inMemory() {
+  for (const auto &toolchain : available())
+    if (toolchain.canRunInMemory())
+      return &toolchain;
+  return nullptr;
+}
+
+bool Toolchain::probe(const QString &program, Kind *kind, QString *version) {
+  QProcess process;
+  process.setProcessChannelMode(QProcess::MergedChannels);
+  // tcc prints its version for -v, gcc and clang for --version
+  process.start(program, {program.contains("tcc") ? "-v" : "--version"});
+  if (!process.waitForFinished(5000))
+    return false;
+  const QString output = QString::fromLocal8Bit(process.readAll());
+  if (output.contains("clang", Qt::CaseInsensitive))
+    *kind = Clang;
+  else if (output.contains("tcc", Qt::CaseInsensitive))
+    *kind = Tcc;
+  else if (output.contains("gcc", Qt::CaseInsensitive) ||
+           output.contains("Free Software Foundation"))
+    *kind = Gcc;
+  else
+    return false;
+  static const QRegularExpression number(R"(\d+\.\d+(\.\d+)?)");
+  *version = number.match(output).captured();
+  return true;
+}
+
+QString Toolchain::name() const {
+  static const char *const names[] = {"gcc", "clang", "tcc"};
+  return m_version.isEmpty() ? QString(names[m_kind])
+                             : QString("%1 %2").arg(names[m_kind], m_version);
+}
+
+bool Toolchain::canTimeTrace() const {
+  return m_kind == Clang && m_version.section('.', 0, 0).toInt() >= 16;
+}
+
+QStringList Toolchain::compileArguments(const QString &output) const {
+  // gcc adds .exe to the name where executables need it
+  return {"-x", "c", "-Wall", "-", "-o", output};
+}
+
+QStringList Toolchain::runArguments(const QString &sourceFile) const {
+  return {"-Wall", "-run", sourceFile};
+}
+
+// in two steps, a compile and link in one names the notes after the output
+// since gcc 11
+QStringList Toolchain::coverageCompileArguments(const QString &sourceFile,
+                                                const QString &object) const {
+  return {"--coverage", "-O0", "-x", "c", "-c", sourceFile, "-o", object};
+}
+
+QStringList Toolchain::coverageLinkArguments(const QString &object,
+                                             const QString &output) const {
+  return {"--coverage", object, "-o", output};
+}
+
+QStringList Toolchain::coverageTool() const {
+  // gcov-12 goes with gcc-12 and llvm-cov-15 with clang-15, from the same
+  // directory
+  const QFileInfo info(m_program);
+  QString name = info.fileName();
+  if (m_kind == Clang)
+    name.replace("clang", "llvm-cov");
+  else
+    name.replace("gcc", "gcov");
+  const QString tool =
+      m_program.contains('/') ? info.dir().filePath(name) : name;
+  if (m_kind == Clang)
+    return {tool, "gcov"};
+  return {tool};
+}
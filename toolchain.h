@@ -0,0 +1,59 @@
+#ifndef TOOLCHAIN_H
+#define TOOLCHAIN_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// a C compiler found next to the editor or on the path; what it is and which
+// version is probed once per executable and cached on disk, so detection
+// only costs a few stats after the first run
+class Toolchain {
+public:
+  enum Kind { Gcc, Clang, Tcc };
+
+  Toolchain() = default;
+  Toolchain(Kind kind, const QString &program, const QString &version = {});
+
+  // every toolchain found, the ones that optimize first; the first call
+  // detects them and may block for seconds, later ones wait for it
+  static const QVector<Toolchain> &available();
+  // the first one that compiles and runs in memory, if any
+  static const Toolchain *inMemory();
+  static QString cachePath();
+
+  bool isNull() const { return m_program.isEmpty(); }
+  Kind kind() const { return m_kind; }
+  const QString &program() const { return m_program; }
+  const QString &version() const { return m_version; }
+  QString name() const;
+
+  bool canTimeReport() const { return m_kind != Tcc; }
+  // -ftime-trace=<dir>, clang 16 and newer
+  bool canTimeTrace() const;
+  bool canRunInMemory() const { return m_kind == Tcc; }
+  // --coverage builds whose counts gcov, or llvm-cov gcov, can read
+  bool canProfileLines() const { return m_kind != Tcc; }
+
+  // compiles the C source written to stdin into output, ./a by default
+  QStringList compileArguments(const QString &output = "a") const;
+  // compiles sourceFile and runs it without writing an executable
+  QStringList runArguments(const QString &sourceFile) const;
+  // compiles sourceFile into object with coverage counters, the notes file
+  // goes next to object
+  QStringList coverageCompileArguments(const QString &sourceFile,
+                                       const QString &object) const;
+  // links object, built as above, into output
+  QStringList coverageLinkArguments(const QString &object,
+                                    const QString &output) const;
+  // the gcov of this compiler and its leading arguments
+  QStringList coverageTool() const;
+
+private:
+  Kind m_kind = Gcc;
+  QString m_program, m_version;
+
+  static bool probe(const QString &program, Kind *kind, QString *version);
+};
+
+#endif // TOOLCHAIN_H
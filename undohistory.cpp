@@ -0,0 +1,190 @@
+#include "undohistory.h"
+#include "documentedits.h"
+#include <QDebug>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QTimer>
+#include <QtConcurrent>
+#include <algorithm>
+
+namespace {
+// what the document's undo stack roughly spends per step on top of the text
+const qint64 stepOverhead = 64;
+
+QByteArray compressText(const QString &text) {
+  return qCompress(text.toUtf8(), 1);
+}
+
+qint64 snapshotBytes(const QVector<QByteArray> &snapshots) {
+  qint64 bytes = 0;
+  for (const auto &s : snapshots)
+    bytes += s.size();
+  return bytes;
+}
+} // namespace
+
+UndoHistory::UndoHistory(QTextDocument *document, QObject *parent)
+    : QObject(parent), m_document{document} {
+  connect(DocumentEdits::of(m_document), &DocumentEdits::edited, this,
+          &UndoHistory::contentsChange);
+  reset();
+}
+
+UndoHistory::~UndoHistory() { m_baseCompression.waitForFinished(); }
+
+void UndoHistory::setMemoryBudget(qint64 bytes) {
+  m_budget = bytes;
+  if (memoryUsage() > m_budget)
+    compact();
+}
+
+void UndoHistory::typed(int position, const QString &text) {
+  auto endsWord = [](QChar c) { return !c.isLetterOrNumber() && c != '_'; };
+  const bool endsGroup =
+      m_grouping == Word ? std::any_of(text.begin(), text.end(), endsWord)
+                         : text.contains('\n') || text.contains('\r');
+  m_typingEnd = endsGroup ? -1 : position;
+}
+
+void UndoHistory::reset() {
+  m_undoSnapshots.clear();
+  m_redoSnapshots.clear();
+  m_stepBytes = m_snapshotBytes = 0;
+  m_typingEnd = -1;
+  startBaseSnapshot();
+  emit memoryUsageChanged(memoryUsage());
+}
+
+void UndoHistory::startBaseSnapshot() {
+  m_baseCompression.waitForFinished();
+  // copying the text is cheap, compressing it is left to a worker
+  const QString text = m_document->toPlainText();
+  m_baseCompression =
+      QtConcurrent::run([text]() { return compressText(text); });
+  m_compressingBase = true;
+}
+
+QByteArray UndoHistory::base() {
+  if (m_compressingBase) {
+    m_base = m_baseCompression.result();
+    m_compressingBase = false;
+  }
+  return m_base;
+}
+
+void UndoHistory::contentsChange(int, int charsRemoved, int charsAdded) {
+  if (m_replaying)
+    return; // undo and redo reuse steps that were already accounted for
+  if (!m_redoSnapshots.isEmpty()) {
+    m_redoSnapshots.clear(); // a new edit ends the redo history
+    m_snapshotBytes = snapshotBytes(m_undoSnapshots);
+  }
+  m_stepBytes += (charsRemoved + charsAdded) * qint64(sizeof(QChar)) +
+                 stepOverhead;
+  if (memoryUsage() > m_budget && !m_compactPending) {
+    // the document is in the middle of an edit, compact once it is done
+    m_compactPending = true;
+    QTimer::singleShot(0, this, &UndoHistory::compact);
+  }
+  emit memoryUsageChanged(memoryUsage());
+}
+
+void UndoHistory::compact() {
+  m_compactPending = false;
+  if (m_stepBytes == 0)
+    return;
+
+  // the steps since the base are replaced by the base itself
+  m_undoSnapshots << base();
+  m_redoSnapshots.clear();
+  m_document->clearUndoRedoStacks();
+  m_stepBytes = 0;
+  m_typingEnd = -1;
+  startBaseSnapshot();
+  trimSnapshots();
+  qDebug() << "Compacted undo history to" << m_undoSnapshots.size()
+           << "snapshots," << m_snapshotBytes << "bytes";
+  emit memoryUsageChanged(memoryUsage());
+}
+
+void UndoHistory::trimSnapshots() {
+  // the oldest history goes first, then the redo snapshots furthest away
+  while (snapshotBytes(m_undoSnapshots) + snapshotBytes(m_redoSnapshots) >
+         m_budget / 2) {
+    if (!m_undoSnapshots.isEmpty())
+      m_undoSnapshots.removeFirst();
+    else if (!m_redoSnapshots.isEmpty())
+      m_redoSnapshots.removeFirst();
+    else
+      break;
+  }
+  m_snapshotBytes =
+      snapshotBytes(m_undoSnapshots) + snapshotBytes(m_redoSnapshots);
+}
+
+void UndoHistory::restoreSnapshot(const QByteArray &snapshot,
+                                  QTextCursor *cursor) {
+  const int position = cursor->position();
+  m_replaying = true;
+  // with undo disabled the replacement does not become a step of its own
+  m_document->setUndoRedoEnabled(false);
+  QTextCursor all(m_document);
+  all.select(QTextCursor::Document);
+  all.insertText(QString::fromUtf8(qUncompress(snapshot)));
+  m_document->setUndoRedoEnabled(true);
+  m_replaying = false;
+
+  cursor->setPosition(std::min(position, m_document->characterCount() - 1));
+  m_stepBytes = 0;
+  m_typingEnd = -1;
+  m_baseCompression.waitForFinished();
+  m_compressingBase = false;
+  m_base = snapshot;
+  trimSnapshots();
+  emit memoryUsageChanged(memoryUsage());
+}
+
+bool UndoHistory::isUndoAvailable() const {
+  return m_document->isUndoAvailable() || !m_undoSnapshots.isEmpty();
+}
+
+bool UndoHistory::isRedoAvailable() const {
+  return m_document->isRedoAvailable() || !m_redoSnapshots.isEmpty();
+}
+
+void UndoHistory::undo(QTextCursor *cursor) {
+  m_typingEnd = -1;
+  if (m_document->isUndoAvailable()) {
+    m_replaying = true;
+    m_document->undo(cursor);
+    m_replaying = false;
+  } else if (!m_undoSnapshots.isEmpty()) {
+    // restoring the snapshot clears the document's stacks, so the steps
+    // undone down to the base are redone and kept as one snapshot of where
+    // the undoing started; no edit came since, or they would have cleared
+    // the redo snapshots
+    if (m_document->isRedoAvailable()) {
+      QTextCursor replay(m_document);
+      m_replaying = true;
+      while (m_document->isRedoAvailable())
+        m_document->redo(&replay);
+      m_replaying = false;
+      m_redoSnapshots << compressText(m_document->toPlainText());
+    }
+    // the base is what every step was undone to, so it is redone first
+    m_redoSnapshots << base();
+    restoreSnapshot(m_undoSnapshots.takeLast(), cursor);
+  }
+}
+
+void UndoHistory::redo(QTextCursor *cursor) {
+  m_typingEnd = -1;
+  if (m_document->isRedoAvailable()) {
+    m_replaying = true;
+    m_document->redo(cursor);
+    m_replaying = false;
+  } else if (!m_redoSnapshots.isEmpty()) {
+    m_undoSnapshots << compressText(m_document->toPlainText());
+    restoreSnapshot(m_redoSnapshots.takeLast(), cursor);
+  }
+}
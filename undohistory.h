@@ -0,0 +1,70 @@
+#ifndef UNDOHISTORY_H
+#define UNDOHISTORY_H
+
+#include <QByteArray>
+#include <QFuture>
+#include <QObject>
+#include <QVector>
+
+class QTextCursor;
+class QTextDocument;
+
+// keeps the undo history of a document within a memory budget: typing is
+// grouped into word or line sized steps, and once the budget is exceeded the
+// steps are dropped for a compressed snapshot of the text before them
+class UndoHistory : public QObject {
+  Q_OBJECT
+public:
+  enum Grouping { Word, Line };
+
+  explicit UndoHistory(QTextDocument *document, QObject *parent = nullptr);
+  ~UndoHistory() override;
+
+  qint64 memoryBudget() const { return m_budget; }
+  void setMemoryBudget(qint64 bytes);
+  Grouping grouping() const { return m_grouping; }
+  void setGrouping(Grouping grouping) { m_grouping = grouping; }
+
+  // estimated bytes held by undo steps and snapshots
+  qint64 memoryUsage() const { return m_stepBytes + m_snapshotBytes; }
+
+  // whether text typed at position joins the previous undo step
+  bool continuesTyping(int position) const { return position == m_typingEnd; }
+  // text was typed and the cursor is now at position
+  void typed(int position, const QString &text);
+  void breakTyping() { m_typingEnd = -1; }
+
+  bool isUndoAvailable() const;
+  bool isRedoAvailable() const;
+  void undo(QTextCursor *cursor);
+  void redo(QTextCursor *cursor);
+  // forgets all history, after the document got new contents
+  void reset();
+
+signals:
+  void memoryUsageChanged(qint64 bytes);
+
+private:
+  QTextDocument *m_document;
+  qint64 m_budget = 32 * 1024 * 1024;
+  Grouping m_grouping = Word;
+  qint64 m_stepBytes = 0, m_snapshotBytes = 0;
+  int m_typingEnd = -1;
+  bool m_replaying = false, m_compactPending = false;
+
+  // text as it was when the document's own undo stack was last cleared,
+  // compressed by a worker while m_compressingBase is set
+  QByteArray m_base;
+  QFuture<QByteArray> m_baseCompression;
+  bool m_compressingBase = false;
+  QVector<QByteArray> m_undoSnapshots, m_redoSnapshots;
+
+  void contentsChange(int position, int charsRemoved, int charsAdded);
+  void compact();
+  void startBaseSnapshot();
+  QByteArray base();
+  void restoreSnapshot(const QByteArray &snapshot, QTextCursor *cursor);
+  void trimSnapshots();
+};
+
+#endif // UNDOHISTORY_H